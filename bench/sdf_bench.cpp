@@ -0,0 +1,471 @@
+#include "SDFKernels.h"
+#include "SDFMask.h"
+#include "DistanceTransform.h"
+#include "JumpFlood.h"
+#include "TrueType.h"
+#include "FontAtlas.h"
+#include "ThreadPool.h"
+#include "ScratchArena.h"
+#include "Inflate.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Micro-benchmark for the bake kernels, without GLFW or AntTweakBar
+// Prints one JSON document to stdout so results can be diffed between releases
+
+struct Config
+{
+    int texPow;
+    bool circle;
+    float radius; // in the scene's units, percent of the texture size
+    int threads;
+    SimdLevel level;
+};
+
+struct Result
+{
+    double meanNsPerTexel;
+    double varianceNsPerTexel;
+    double minNsPerTexel;
+    double meanMTexelsPerSec;
+};
+
+static Result measure(const Config& config, int reps, ThreadPool& pool, ScratchArena& arena)
+{
+    const int texSize = 1 << config.texPow;
+    const size_t texels = size_t(texSize) * texSize;
+    const float radius = config.radius * texSize * 0.01f;
+    const SDFKernels& kernels = SDFKernels::get(config.level);
+    const SDFRowKernel rowKernel = config.circle ? kernels.circleRow : kernels.boxRow;
+    const int tileRows = SDFKernels::tileRows(texSize);
+    int8_t* texData = arena.get<int8_t>(texels);
+
+    auto bake = [&]()
+    {
+        pool.parallelFor(texSize / tileRows, [&](int tile)
+        {
+            SDFKernels::bakeRows(rowKernel, texSize, radius, &texData[size_t(tile) * tileRows * texSize], tile * tileRows, tileRows);
+        });
+    };
+
+    // NOTE one untimed bake to fault in the pages and wake the workers
+    bake();
+
+    std::vector<double> samples(reps);
+    for (int i = 0; i < reps; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        bake();
+        const auto end = std::chrono::steady_clock::now();
+        samples[i] = std::chrono::duration<double, std::nano>(end - start).count() / texels;
+    }
+
+    Result result = {0.0, 0.0, samples[0], 0.0};
+    for (double ns : samples)
+    {
+        result.meanNsPerTexel += ns;
+        result.minNsPerTexel = std::min(result.minNsPerTexel, ns);
+        result.meanMTexelsPerSec += 1e3 / ns;
+    }
+    result.meanNsPerTexel /= reps;
+    result.meanMTexelsPerSec /= reps;
+    for (double ns : samples)
+        result.varianceNsPerTexel += (ns - result.meanNsPerTexel) * (ns - result.meanNsPerTexel);
+    result.varianceNsPerTexel /= std::max(reps - 1, 1);
+
+    return result;
+}
+
+// Same math as the row kernels in double precision, narrowed the same way
+static int8_t referenceTexel(bool circle, double px, double py, double radius)
+{
+    double dist;
+    if (circle)
+    {
+        dist = sqrt(px*px + py*py) - radius;
+    }
+    else
+    {
+        const double qx = fabs(px) - radius;
+        const double qy = fabs(py) - radius;
+        const double ox = std::max(qx, 0.0);
+        const double oy = std::max(qy, 0.0);
+        dist = sqrt(ox*ox + oy*oy) + std::min(std::max(qx, qy), 0.0);
+    }
+    return int8_t(int32_t(-dist * 127 / radius));
+}
+
+// Steps between two texels, counting the int8 wraparound as a single step like the narrowing does
+static int quantizationSteps(int8_t a, int8_t b)
+{
+    const int diff = uint8_t(a - b);
+    return std::min(diff, 256 - diff);
+}
+
+// Counts the malformed zlib streams the decoder accepts, which should be none. Each is a dynamic block whose
+// header counts more code lengths than DEFLATE allows, then sends that many zeros.
+static int malformedInflateAccepted()
+{
+    static const uint8_t STREAMS[][9] =
+    {
+        {0x78, 0x01, 0xFD, 0x00, 0x80, 0xE4, 0xFF, 0xBF, 0x00}, // 288 literal lengths
+        {0x78, 0x01, 0xED, 0x1F, 0x80, 0xE4, 0xFF, 0xFF, 0x07}, // 32 distance lengths
+    };
+
+    int accepted = 0;
+    for (const auto& stream : STREAMS)
+    {
+        bool pending = true;
+        accepted += Inflate::zlib([&](const uint8_t*& data, size_t& size)
+        {
+            data = stream;
+            size = sizeof(stream);
+            return std::exchange(pending, false);
+        }, [](const uint8_t*, size_t) {return true;});
+    }
+    return accepted;
+}
+
+// Checks every supported SIMD level against the double-precision reference; a texel may only be off by
+// the one step float rounding can move it across a truncation boundary. The SIMD levels must also match
+// the scalar kernel byte for byte, since the scene switches between them freely. The mask decoder's
+// inflate must reject malformed streams too.
+static bool verifyKernels()
+{
+    const SimdLevel best = SDFKernels::detect();
+    const float radii[] = {0.1f, 0.8f, 2.f, 4.f, 37.5f, 100.f};
+    const int counts[] = {1, 3, 5, 7, 9, 15, 17, 31, 33, 63, 65, 100}; // every SIMD width plus its scalar tail
+    const SDFKernels& scalar = SDFKernels::get(SimdLevel::Scalar);
+    std::vector<int8_t> row(1024), scalarRow(1024);
+    bool passed = true;
+
+    printf("{\n");
+    printf("  \"best_simd\": \"%s\",\n", SDFKernels::name(best));
+    printf("  \"verify\": [");
+
+    bool first = true;
+    for (int level = int(SimdLevel::Scalar); level <= int(best); ++level)
+    {
+        const SDFKernels& kernels = SDFKernels::get(SimdLevel(level));
+        for (int shape = 0; shape < 2; ++shape)
+        {
+            const SDFRowKernel rowKernel = shape == 0 ? kernels.circleRow : kernels.boxRow;
+            const SDFRowKernel scalarKernel = shape == 0 ? scalar.circleRow : scalar.boxRow;
+            size_t texels = 0, failures = 0, mismatches = 0;
+            int maxSteps = 0;
+            auto check = [&](int count, float fx, float fy, float radius)
+            {
+                rowKernel(row.data(), count, fx, fy, radius);
+                scalarKernel(scalarRow.data(), count, fx, fy, radius);
+                for (int x = 0; x < count; ++x)
+                {
+                    const int steps = quantizationSteps(row[x], referenceTexel(shape == 0, double(fx) + x, fy, radius));
+                    maxSteps = std::max(maxSteps, steps);
+                    failures += steps > 1;
+                    mismatches += row[x] != scalarRow[x];
+                }
+                texels += count;
+            };
+
+            // Whole fields the way bakeRows lays them out, with the radius in the scene's units
+            for (int texPow = 2; texPow <= 10; ++texPow)
+            {
+                const int texSize = 1 << texPow;
+                const float fx = -(texSize / 2) + 0.5f;
+                for (float radius : radii)
+                {
+                    for (int y = 0; y < texSize; ++y)
+                        check(texSize, fx, y - (texSize / 2) + 0.5f, radius * texSize * 0.01f);
+                }
+            }
+
+            // Ragged rows at fractional offsets, so each kernel's tail and its fallbacks run too
+            std::mt19937 rng(level * 2 + shape);
+            std::uniform_real_distribution<float> offset(-64.f, 64.f);
+            std::uniform_real_distribution<float> size(0.05f, 48.f);
+            for (int i = 0; i < 2000; ++i)
+            {
+                for (int count : counts)
+                    check(count, offset(rng), offset(rng), size(rng));
+            }
+
+            printf("%s\n    {\"simd\": \"%s\", \"shape\": \"%s\", \"texels\": %zu, \"max_steps\": %d, \"failures\": %zu, "
+                   "\"scalar_mismatches\": %zu}",
+                   first ? "" : ",", SDFKernels::name(SimdLevel(level)), shape == 0 ? "circle" : "square", texels, maxSteps, failures,
+                   mismatches);
+            fflush(stdout);
+            first = false;
+            passed = passed && failures == 0 && mismatches == 0;
+        }
+    }
+
+    printf("\n  ],\n");
+    const int accepted = malformedInflateAccepted();
+    printf("  \"malformed_inflate_accepted\": %d,\n", accepted);
+    passed = passed && accepted == 0;
+    printf("  \"passed\": %s\n}\n", passed ? "true" : "false");
+    return passed;
+}
+
+// Mean and min over reps of one call, after an untimed one
+template <typename Fn>
+static void timeMs(int reps, const Fn& fn, double& meanMs, double& minMs)
+{
+    fn();
+    meanMs = 0.0;
+    minMs = 0.0;
+    for (int i = 0; i < reps; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        meanMs += ms;
+        minMs = i == 0 ? ms : std::min(minMs, ms);
+    }
+    meanMs /= reps;
+}
+
+// How far an approximate field is from the exact transform, in texels
+struct FieldError
+{
+    double maxError;
+    double meanError;
+    double wrongFraction; // texels off by more than float rounding
+};
+
+static FieldError compareFields(const float* approx, const float* exact, size_t texels)
+{
+    FieldError error = {0.0, 0.0, 0.0};
+    size_t wrong = 0;
+    for (size_t i = 0; i < texels; ++i)
+    {
+        const double diff = fabs(double(approx[i]) - exact[i]);
+        error.maxError = std::max(error.maxError, diff);
+        error.meanError += diff;
+        if (diff > 1e-3)
+            ++wrong;
+    }
+    error.meanError /= texels;
+    error.wrongFraction = double(wrong) / texels;
+    return error;
+}
+
+enum MaskShape
+{
+    MASK_CIRCLE,
+    MASK_SQUARE,
+    MASK_NOISE, // scattered texels, which is where jump flooding goes wrong most often
+    MASK_COUNT
+};
+
+static const char* const MASK_NAMES[MASK_COUNT] = {"circle", "square", "noise"};
+
+static void makeMask(MaskShape shape, int texSize, uint8_t* mask, ThreadPool& pool)
+{
+    if (shape == MASK_NOISE)
+    {
+        std::mt19937 rng(texSize);
+        for (size_t i = 0; i < size_t(texSize) * texSize; ++i)
+            mask[i] = rng() % 8 == 0;
+        return;
+    }
+    SDFMask::rasterize(shape == MASK_CIRCLE, texSize, texSize * 0.3f, mask, pool);
+}
+
+// Times the mask generators and reports how far jump flooding is from the exact transform
+static void benchGenerators(int reps, int minPow, int maxPow, ThreadPool& pool)
+{
+    ScratchArena scratch;
+    printf("  \"generators\": [");
+
+    bool first = true;
+    for (int texPow = minPow; texPow <= maxPow; ++texPow)
+    {
+        const int texSize = 1 << texPow;
+        const size_t texels = size_t(texSize) * texSize;
+        std::vector<uint8_t> mask(texels);
+        std::vector<float> exact(texels), approx(texels);
+
+        for (int shape = 0; shape < MASK_COUNT; ++shape)
+        {
+            makeMask(MaskShape(shape), texSize, mask.data(), pool);
+
+            double meanMs, minMs;
+            timeMs(reps, [&]() {DistanceTransform::distances(mask.data(), texSize, exact.data(), pool, scratch);}, meanMs, minMs);
+            printf("%s\n    {\"tex_pow\": %d, \"mask\": \"%s\", \"threads\": %d, \"generator\": \"edt\", \"ms\": %.3f, \"ms_min\": %.3f}",
+                   first ? "" : ",", texPow, MASK_NAMES[shape], pool.size(), meanMs, minMs);
+            first = false;
+
+            for (bool correction : {false, true})
+            {
+                timeMs(reps, [&]() {JumpFlood::distances(mask.data(), texSize, approx.data(), pool, scratch, correction);}, meanMs, minMs);
+                const FieldError error = compareFields(approx.data(), exact.data(), texels);
+                printf(",\n    {\"tex_pow\": %d, \"mask\": \"%s\", \"threads\": %d, \"generator\": \"%s\", \"passes\": %d, "
+                       "\"ms\": %.3f, \"ms_min\": %.3f, \"max_error\": %.4f, \"mean_error\": %.3e, \"wrong_fraction\": %.3e}",
+                       texPow, MASK_NAMES[shape], pool.size(), correction ? "1+jfa" : "jfa", JumpFlood::passes(texSize, correction),
+                       meanMs, minMs, error.maxError, error.meanError, error.wrongFraction);
+            }
+            fflush(stdout);
+        }
+    }
+
+    printf("\n  ]");
+}
+
+// Time to a finished glyph atlas of every code point in the font, at each thread count
+static void benchFontAtlas(int reps, const TrueTypeFont& font, const std::vector<int>& threadCounts, ThreadPool& pool)
+{
+    const float pixelSizes[] = {16.f, 32.f, 64.f};
+    const int spread = 4;
+    printf("  \"font_atlas\": [");
+
+    bool first = true;
+    FontAtlas atlas;
+    for (int threads : threadCounts)
+    {
+        pool.resize(threads);
+        for (float pixelSize : pixelSizes)
+        {
+            double meanMs, minMs;
+            timeMs(reps, [&]() {atlas.bake(font, pixelSize, spread, 16384, pool);}, meanMs, minMs);
+            printf("%s\n    {\"pixel_size\": %.0f, \"spread\": %d, \"threads\": %d, \"glyphs\": %zu, \"width\": %d, \"height\": %d, "
+                   "\"ms\": %.3f, \"ms_min\": %.3f}",
+                   first ? "" : ",", pixelSize, spread, threads, atlas.glyphs().size(), atlas.width(), atlas.height(), meanMs, minMs);
+            fflush(stdout);
+            first = false;
+        }
+    }
+
+    printf("\n  ]");
+}
+
+static void usage(const char* program)
+{
+    fprintf(stderr, "Usage: %s [--reps N] [--min-pow P] [--max-pow P] [--max-threads T] [--no-generators] [--font FILE] [--verify]\n", program);
+}
+
+int main(int argc, char* argv[])
+{
+    int reps = 10;
+    int minPow = 6;
+    int maxPow = 12;
+    int maxThreads = ThreadPool::hardwareThreads();
+    bool generators = true;
+    const char* fontPath = nullptr;
+    bool verify = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc)
+            reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--min-pow") == 0 && i + 1 < argc)
+            minPow = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-pow") == 0 && i + 1 < argc)
+            maxPow = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc)
+            maxThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-generators") == 0)
+            generators = false;
+        else if (strcmp(argv[i], "--font") == 0 && i + 1 < argc)
+            fontPath = argv[++i];
+        else if (strcmp(argv[i], "--verify") == 0)
+            verify = true;
+        else
+        {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (reps < 1 || minPow < 1 || maxPow > 14 || minPow > maxPow || maxThreads < 1)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+
+    // NOTE checks the kernels instead of timing them, and fails the run if any is off
+    if (verify)
+        return verifyKernels() ? 0 : 1;
+
+    TrueTypeFont font;
+    if (fontPath && !font.open(fontPath))
+    {
+        fprintf(stderr, "Failed to open font %s\n", fontPath);
+        return -1;
+    }
+
+    // Powers of two up to the limit, plus the limit itself
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    const float radii[] = {0.8f, 2.f, 4.f};
+    const SimdLevel best = SDFKernels::detect();
+
+    ThreadPool pool(1);
+    ScratchArena arena;
+
+    printf("{\n");
+    printf("  \"reps\": %d,\n", reps);
+    printf("  \"hardware_threads\": %d,\n", ThreadPool::hardwareThreads());
+    printf("  \"best_simd\": \"%s\",\n", SDFKernels::name(best));
+    printf("  \"tile_texels\": %d,\n", SDFKernels::TILE_TEXELS);
+    printf("  \"results\": [");
+
+    bool first = true;
+    for (int threads : threadCounts)
+    {
+        pool.resize(threads);
+        for (int level = int(SimdLevel::Scalar); level <= int(best); ++level)
+        {
+            for (int texPow = minPow; texPow <= maxPow; ++texPow)
+            {
+                for (int shape = 0; shape < 2; ++shape)
+                {
+                    for (float radius : radii)
+                    {
+                        const Config config = {texPow, shape == 0, radius, threads, SimdLevel(level)};
+                        const Result result = measure(config, reps, pool, arena);
+
+                        printf("%s\n    {\"tex_pow\": %d, \"shape\": \"%s\", \"radius\": %.2f, \"threads\": %d, \"simd\": \"%s\", "
+                               "\"mtexels_per_sec\": %.3f, \"ns_per_texel\": %.5f, \"ns_per_texel_min\": %.5f, \"ns_per_texel_variance\": %.3e}",
+                               first ? "" : ",", config.texPow, config.circle ? "circle" : "square", config.radius, config.threads,
+                               SDFKernels::name(config.level), result.meanMTexelsPerSec, result.meanNsPerTexel,
+                               result.minNsPerTexel, result.varianceNsPerTexel);
+                        fflush(stdout);
+                        first = false;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("\n  ]");
+
+    // The generators only run at the full thread count; their scaling follows the same pool
+    if (generators)
+    {
+        printf(",\n");
+        pool.resize(maxThreads);
+        benchGenerators(reps, minPow, maxPow, pool);
+    }
+
+    if (fontPath)
+    {
+        printf(",\n");
+        benchFontAtlas(reps, font, threadCounts, pool);
+    }
+
+    printf("\n}\n");
+
+    return 0;
+}
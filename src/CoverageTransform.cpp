@@ -0,0 +1,266 @@
+#include "CoverageTransform.h"
+#include "SDFMask.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Distance of a texel that no edge has reached yet
+static constexpr float FAR = 1e6f;
+
+// Only take a new edge texel if it's clearly closer, so rounding can't keep the sweeps going
+static constexpr float EPSILON = 1e-3f;
+
+// Largest magnitude edgeDistance can return
+static constexpr float MAX_EDGE_OFFSET = 0.7072f;
+
+// Distance from a texel center to the edge crossing it, for an edge with normal (gx, gy) that covers a of the texel
+// Exact for a straight edge; positive if the center is outside the covered part
+static float edgeDistance(float gx, float gy, float a)
+{
+    if (gx == 0.f || gy == 0.f)
+        return 0.5f - a;
+
+    const float length = sqrtf(gx * gx + gy * gy);
+    gx = fabsf(gx / length);
+    gy = fabsf(gy / length);
+    if (gx < gy)
+        std::swap(gx, gy);
+
+    // Below a1 the covered part is a triangle in one corner, above 1 - a1 everything but one
+    const float a1 = 0.5f * gy / gx;
+    if (a < a1)
+        return 0.5f * (gx + gy) - sqrtf(2.f * gx * gy * a);
+    if (a < 1.f - a1)
+        return (0.5f - a) * gx;
+    return -0.5f * (gx + gy) + sqrtf(2.f * gx * gy * (1.f - a));
+}
+
+namespace
+{
+    // Distance to the nearest edge and the offset to the edge texel it was measured from
+    struct Field
+    {
+        float* dist;
+        int16_t* offsetX;
+        int16_t* offsetY;
+    };
+
+    class Sweeper
+    {
+        const uint8_t* m_coverage;
+        int m_width, m_height;
+        bool m_invert;
+        Field m_field;
+        bool m_changed;
+
+    public:
+        Sweeper(const uint8_t* coverage, int width, int height, bool invert, Field field):
+            m_coverage(coverage), m_width(width), m_height(height), m_invert(invert), m_field(field), m_changed(false) {}
+
+        float alpha(size_t i) const
+        {
+            const float a = m_coverage[i] * (1.f / 255.f);
+            return m_invert ? 1.f - a : a;
+        }
+
+        void init()
+        {
+            for (int y = 0; y < m_height; ++y)
+            {
+                for (int x = 0; x < m_width; ++x)
+                {
+                    const size_t i = size_t(y) * m_width + x;
+                    const float a = alpha(i);
+                    m_field.offsetX[i] = 0;
+                    m_field.offsetY[i] = 0;
+                    if (a <= 0.f)
+                        m_field.dist[i] = FAR;
+                    else if (a < 1.f)
+                        m_field.dist[i] = edgeDistance(gradientX(x, y), gradientY(x, y), a);
+                    else
+                        m_field.dist[i] = 0.f;
+                }
+            }
+        }
+
+        // Forward and backward raster sweeps, repeated until nothing gets closer if asked to
+        void run(bool settle)
+        {
+            do
+            {
+                m_changed = false;
+                for (int y = 0; y < m_height; ++y)
+                {
+                    for (int x = 0; x < m_width; ++x)
+                    {
+                        relax(x, y, -1, 0);
+                        relax(x, y, -1, -1);
+                        relax(x, y, 0, -1);
+                        relax(x, y, 1, -1);
+                    }
+                    for (int x = m_width - 1; x >= 0; --x)
+                        relax(x, y, 1, 0);
+                }
+                for (int y = m_height - 1; y >= 0; --y)
+                {
+                    for (int x = m_width - 1; x >= 0; --x)
+                    {
+                        relax(x, y, 1, 0);
+                        relax(x, y, 1, 1);
+                        relax(x, y, 0, 1);
+                        relax(x, y, -1, 1);
+                    }
+                    for (int x = 0; x < m_width; ++x)
+                        relax(x, y, -1, 0);
+                }
+            }
+            while (settle && m_changed);
+        }
+
+    private:
+        // Sobel-like gradient, left at zero on the border; only its direction matters
+        float gradientX(int x, int y) const
+        {
+            if (x == 0 || y == 0 || x == m_width - 1 || y == m_height - 1)
+                return 0.f;
+            const size_t i = size_t(y) * m_width + x;
+            const size_t w = m_width;
+            return -float(m_coverage[i-w-1]) - sqrtf(2.f) * m_coverage[i-1] - m_coverage[i+w-1]
+                + m_coverage[i-w+1] + sqrtf(2.f) * m_coverage[i+1] + m_coverage[i+w+1];
+        }
+
+        float gradientY(int x, int y) const
+        {
+            if (x == 0 || y == 0 || x == m_width - 1 || y == m_height - 1)
+                return 0.f;
+            const size_t i = size_t(y) * m_width + x;
+            const size_t w = m_width;
+            return -float(m_coverage[i-w-1]) - sqrtf(2.f) * m_coverage[i-w] - m_coverage[i-w+1]
+                + m_coverage[i+w-1] + sqrtf(2.f) * m_coverage[i+w] + m_coverage[i+w+1];
+        }
+
+        // Offers texel (x, y) the edge texel its neighbor at (x + dx, y + dy) measures from
+        void relax(int x, int y, int dx, int dy)
+        {
+            const int nx = x + dx, ny = y + dy;
+            if (nx < 0 || ny < 0 || nx >= m_width || ny >= m_height)
+                return;
+            const size_t n = size_t(ny) * m_width + nx;
+            if (m_field.dist[n] >= FAR)
+                return;
+
+            const int ox = dx + m_field.offsetX[n];
+            const int oy = dy + m_field.offsetY[n];
+            const int offset2 = ox * ox + oy * oy;
+
+            // Measuring again from the edge texel this one already has can't get any closer
+            // NOTE this includes a zero offset, the texel's own edge, which it started with
+            const size_t i = size_t(y) * m_width + x;
+            if (ox == m_field.offsetX[i] && oy == m_field.offsetY[i])
+                return;
+
+            // The edge is never more than half a diagonal nearer than the edge texel's center
+            const float bound = m_field.dist[i] + MAX_EDGE_OFFSET;
+            if (bound <= 0.f || float(offset2) >= bound * bound)
+                return;
+
+            const size_t edge = size_t(y + oy) * m_width + (x + ox);
+            const float a = alpha(edge);
+            if (a <= 0.f)
+                return;
+
+            // The edge lies across the line to the texel, so the offset stands in for its normal
+            const float dist = sqrtf(float(offset2)) + edgeDistance(float(ox), float(oy), a);
+            if (dist < m_field.dist[i] - EPSILON)
+            {
+                m_field.dist[i] = dist;
+                m_field.offsetX[i] = int16_t(ox);
+                m_field.offsetY[i] = int16_t(oy);
+                m_changed = true;
+            }
+        }
+    };
+
+    // Runs a pool's jobs on the calling thread, for a transform that is itself one task of a bigger job
+    struct Serial
+    {
+        template <typename Task>
+        void parallelFor(int count, const Task& task) const
+        {
+            for (int i = 0; i < count; ++i)
+                task(i);
+        }
+    };
+}
+
+template <typename Pool, typename Emit>
+static bool transform(const uint8_t* coverage, int width, int height, bool settle, Pool& pool, ScratchArena& scratch,
+    const Emit& emit)
+{
+    const size_t texels = size_t(width) * height;
+    const size_t distBytes = ScratchArena::align(texels * sizeof(float));
+    const size_t offsetBytes = ScratchArena::align(texels * sizeof(int16_t));
+    const size_t fieldBytes = distBytes + 2 * offsetBytes;
+    uint8_t* memory = scratch.get<uint8_t>(2 * fieldBytes);
+    if (!memory)
+        return false;
+
+    // Distance from outside texels to the shape, and from inside texels to the background
+    Field fields[2];
+    for (int side = 0; side < 2; ++side)
+    {
+        uint8_t* fieldMemory = memory + side * fieldBytes;
+        fields[side].dist = reinterpret_cast<float*>(fieldMemory);
+        fields[side].offsetX = reinterpret_cast<int16_t*>(fieldMemory + distBytes);
+        fields[side].offsetY = reinterpret_cast<int16_t*>(fieldMemory + distBytes + offsetBytes);
+    }
+
+    pool.parallelFor(2, [&](int side)
+    {
+        Sweeper sweeper(coverage, width, height, side == 1, fields[side]);
+        sweeper.init();
+        sweeper.run(settle);
+    });
+
+    const float limit = 2.f * std::max(width, height);
+    pool.parallelFor(height, [&](int y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const size_t i = size_t(y) * width + x;
+            const float outside = std::min(std::max(fields[0].dist[i], 0.f), limit);
+            const float inside = std::min(std::max(fields[1].dist[i], 0.f), limit);
+            emit(x, y, inside - outside);
+        }
+    });
+
+    return true;
+}
+
+bool CoverageTransform::generate(const uint8_t* coverage, int size, float radius, int8_t* dst, ThreadPool& pool, ScratchArena& scratch)
+{
+    return transform(coverage, size, size, true, pool, scratch, [&](int x, int y, float distance)
+    {
+        dst[size_t(y) * size + x] = SDFMask::encode(distance, radius);
+    });
+}
+
+bool CoverageTransform::distances(const uint8_t* coverage, int size, float* dst, ThreadPool& pool, ScratchArena& scratch)
+{
+    return transform(coverage, size, size, true, pool, scratch, [&](int x, int y, float distance)
+    {
+        dst[size_t(y) * size + x] = distance;
+    });
+}
+
+bool CoverageTransform::generateClamped(const uint8_t* coverage, int width, int height, float radius, int8_t* dst, size_t dstStride,
+    ScratchArena& scratch)
+{
+    const Serial serial;
+    // NOTE on glyph-sized fields a second pass has yet to move a texel, so it's skipped
+    return transform(coverage, width, height, false, serial, scratch, [&](int x, int y, float distance)
+    {
+        distance = std::min(std::max(distance, -radius), radius);
+        dst[size_t(y) * dstStride + x] = SDFMask::encode(distance, radius);
+    });
+}
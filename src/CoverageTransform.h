@@ -0,0 +1,32 @@
+#ifndef __COVERAGETRANSFORM_H__
+#define __COVERAGETRANSFORM_H__
+
+#include "ThreadPool.h"
+#include "ScratchArena.h"
+
+#include <cstdint>
+
+// Distance transform of an anti-aliased coverage image, accurate to a fraction of a texel
+// A binary mask only says which side of the edge a texel is on, so its field is off by up to half a texel.
+// Here the coverage and gradient of each edge texel place the edge inside it (Gustavson's edtaa3), then
+// dead reckoning sweeps carry the nearest edge texel outwards. The inside and outside transforms run on
+// two of the pool's threads.
+// NOTE the sweeps are sequential, so this is meant for small fields; it needs 16 bytes of scratch per texel
+class CoverageTransform
+{
+public:
+    // Signed distance field of a size x size image with 0 outside and 255 inside, encoded like the kernels' output
+    static bool generate(const uint8_t* coverage, int size, float radius, int8_t* dst, ThreadPool& pool, ScratchArena& scratch);
+
+    // The same field as plain signed distances in texels, positive inside
+    static bool distances(const uint8_t* coverage, int size, float* dst, ThreadPool& pool, ScratchArena& scratch);
+
+    // Field of a small width x height image, like a glyph, written into a larger one dstStride texels wide
+    // Runs on the calling thread only so it can be one task of a pool job, and sweeps once rather than until
+    // settled. Distances past the radius are clamped rather than wrapped, since a glyph's interior can be deeper
+    // than its padding.
+    static bool generateClamped(const uint8_t* coverage, int width, int height, float radius, int8_t* dst, size_t dstStride,
+        ScratchArena& scratch);
+};
+
+#endif //__COVERAGETRANSFORM_H__
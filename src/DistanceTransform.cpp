@@ -0,0 +1,177 @@
+#include "DistanceTransform.h"
+#include "SDFMask.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Row distance when the row has no texel of that kind
+static constexpr uint16_t NONE = 0xFFFF;
+
+// Stands in for infinity in the parabola math; squares of real distances never get close
+static constexpr double FAR = 1e20;
+
+// Distance along the row to the nearest inside and nearest outside texel
+static void rowPass(const uint8_t* mask, int size, uint16_t* toInside, uint16_t* toOutside)
+{
+    int lastInside = -1, lastOutside = -1;
+    for (int x = 0; x < size; ++x)
+    {
+        if (mask[x])
+            lastInside = x;
+        else
+            lastOutside = x;
+        toInside[x] = lastInside < 0 ? NONE : uint16_t(x - lastInside);
+        toOutside[x] = lastOutside < 0 ? NONE : uint16_t(x - lastOutside);
+    }
+
+    lastInside = -1;
+    lastOutside = -1;
+    for (int x = size - 1; x >= 0; --x)
+    {
+        if (mask[x])
+            lastInside = x;
+        else
+            lastOutside = x;
+        if (lastInside >= 0)
+            toInside[x] = std::min(toInside[x], uint16_t(lastInside - x));
+        if (lastOutside >= 0)
+            toOutside[x] = std::min(toOutside[x], uint16_t(lastOutside - x));
+    }
+}
+
+// 1D squared distance transform of sampled function f: d[q] = min_p (q - p)^2 + f[p]
+// v holds the parabolas of the lower envelope and z the boundaries between them
+static void lowerEnvelope(const double* f, int n, double* d, int* v, double* z)
+{
+    int k = 0;
+    v[0] = 0;
+    z[0] = -FAR;
+    z[1] = FAR;
+    for (int q = 1; q < n; ++q)
+    {
+        double s;
+        while (true)
+        {
+            const int p = v[k];
+            s = ((f[q] + double(q) * q) - (f[p] + double(p) * p)) / (2.0 * (q - p));
+            if (s > z[k])
+                break;
+            --k;
+        }
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k+1] = FAR;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; ++q)
+    {
+        while (z[k+1] < q)
+            ++k;
+        const double dq = q - v[k];
+        d[q] = dq * dq + f[v[k]];
+    }
+}
+
+// Columns gathered at once, so the strided reads of the row pass output use whole cache lines
+static constexpr int BLOCK_COLUMNS = 16;
+
+template <typename Emit>
+static bool transform(const uint8_t* mask, int size, ThreadPool& pool, ScratchArena& scratch, const Emit& emit)
+{
+    // Columns are split into a few chunks per thread, each with its own envelope scratch
+    const int chunks = std::min((size + BLOCK_COLUMNS - 1) / BLOCK_COLUMNS, pool.size() * 4);
+    const size_t fieldBytes = ScratchArena::align(size_t(size) * size * sizeof(uint16_t));
+    const size_t blockBytes = ScratchArena::align(size_t(BLOCK_COLUMNS) * size * sizeof(uint16_t));
+    const size_t distBytes = ScratchArena::align(size_t(BLOCK_COLUMNS) * size * sizeof(float));
+    const size_t lineBytes = ScratchArena::align((size + 1) * sizeof(double));
+    const size_t chunkBytes = 2 * blockBytes + distBytes + 4 * lineBytes + ScratchArena::align(size * sizeof(int));
+    uint8_t* memory = scratch.get<uint8_t>(2 * fieldBytes + chunks * chunkBytes);
+    if (!memory)
+        return false;
+
+    uint16_t* toInside = reinterpret_cast<uint16_t*>(memory);
+    uint16_t* toOutside = reinterpret_cast<uint16_t*>(memory + fieldBytes);
+    pool.parallelFor(size, [&](int y)
+    {
+        const size_t row = size_t(y) * size;
+        rowPass(&mask[row], size, &toInside[row], &toOutside[row]);
+    });
+
+    const float limit = 2.f * size;
+    pool.parallelFor(chunks, [&](int chunk)
+    {
+        uint8_t* chunkMemory = memory + 2 * fieldBytes + chunk * chunkBytes;
+        uint16_t* blockInside = reinterpret_cast<uint16_t*>(chunkMemory);
+        uint16_t* blockOutside = reinterpret_cast<uint16_t*>(chunkMemory + blockBytes);
+        float* blockDist = reinterpret_cast<float*>(chunkMemory + 2 * blockBytes);
+        double* lines = reinterpret_cast<double*>(chunkMemory + 2 * blockBytes + distBytes);
+        double* f = lines;
+        double* dInside = reinterpret_cast<double*>(reinterpret_cast<uint8_t*>(lines) + lineBytes);
+        double* dOutside = reinterpret_cast<double*>(reinterpret_cast<uint8_t*>(lines) + 2 * lineBytes);
+        double* z = reinterpret_cast<double*>(reinterpret_cast<uint8_t*>(lines) + 3 * lineBytes);
+        int* v = reinterpret_cast<int*>(reinterpret_cast<uint8_t*>(lines) + 4 * lineBytes);
+
+        const int x0 = int(int64_t(size) * chunk / chunks);
+        const int x1 = int(int64_t(size) * (chunk + 1) / chunks);
+        for (int bx = x0; bx < x1; bx += BLOCK_COLUMNS)
+        {
+            const int columns = std::min(BLOCK_COLUMNS, x1 - bx);
+            for (int y = 0; y < size; ++y)
+            {
+                const size_t row = size_t(y) * size + bx;
+                for (int c = 0; c < columns; ++c)
+                {
+                    blockInside[c * size + y] = toInside[row + c];
+                    blockOutside[c * size + y] = toOutside[row + c];
+                }
+            }
+
+            for (int c = 0; c < columns; ++c)
+            {
+                const uint16_t* gInside = &blockInside[c * size];
+                const uint16_t* gOutside = &blockOutside[c * size];
+                for (int y = 0; y < size; ++y)
+                    f[y] = gInside[y] == NONE ? FAR : double(gInside[y]) * gInside[y];
+                lowerEnvelope(f, size, dInside, v, z);
+                for (int y = 0; y < size; ++y)
+                    f[y] = gOutside[y] == NONE ? FAR : double(gOutside[y]) * gOutside[y];
+                lowerEnvelope(f, size, dOutside, v, z);
+
+                // Texel centers are a whole texel from their nearest opposite neighbor across an edge
+                // that lies halfway between them; a texel inside has a distance to the outside and vice versa
+                for (int y = 0; y < size; ++y)
+                {
+                    const bool inside = gOutside[y] != 0;
+                    const float dist = std::min(float(sqrt(inside ? dOutside[y] : dInside[y])), limit) - 0.5f;
+                    blockDist[c * size + y] = inside ? dist : -dist;
+                }
+            }
+
+            for (int y = 0; y < size; ++y)
+            {
+                for (int c = 0; c < columns; ++c)
+                    emit(bx + c, y, blockDist[c * size + y]);
+            }
+        }
+    });
+
+    return true;
+}
+
+bool DistanceTransform::generate(const uint8_t* mask, int size, float radius, int8_t* dst, ThreadPool& pool, ScratchArena& scratch)
+{
+    return transform(mask, size, pool, scratch, [&](int x, int y, float distance)
+    {
+        dst[size_t(y) * size + x] = SDFMask::encode(distance, radius);
+    });
+}
+
+bool DistanceTransform::distances(const uint8_t* mask, int size, float* dst, ThreadPool& pool, ScratchArena& scratch)
+{
+    return transform(mask, size, pool, scratch, [&](int x, int y, float distance)
+    {
+        dst[size_t(y) * size + x] = distance;
+    });
+}
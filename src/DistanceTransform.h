@@ -0,0 +1,24 @@
+#ifndef __DISTANCETRANSFORM_H__
+#define __DISTANCETRANSFORM_H__
+
+#include "ThreadPool.h"
+#include "ScratchArena.h"
+
+#include <cstdint>
+
+// Exact Euclidean distance transform of a binary mask in linear time
+// A row pass finds the nearest texel of each kind along the row, then a column pass takes the lower
+// envelope of parabolas (Felzenszwalb & Huttenlocher) to get the true 2D distance. Rows and columns are
+// split across the pool's threads.
+// NOTE needs 4 bytes of scratch per texel, so a 2^14 field needs 1GB
+class DistanceTransform
+{
+public:
+    // Signed distance field of a size x size mask, encoded like the kernels' output
+    static bool generate(const uint8_t* mask, int size, float radius, int8_t* dst, ThreadPool& pool, ScratchArena& scratch);
+
+    // The same field as plain signed distances in texels, positive inside
+    static bool distances(const uint8_t* mask, int size, float* dst, ThreadPool& pool, ScratchArena& scratch);
+};
+
+#endif //__DISTANCETRANSFORM_H__
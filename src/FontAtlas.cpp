@@ -0,0 +1,211 @@
+#include "FontAtlas.h"
+#include "CoverageTransform.h"
+#include "ScratchArena.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+
+namespace
+{
+    // Everything a worker reuses from one glyph to the next; glyphs come largest first, so each arena grows once
+    struct Worker
+    {
+        std::vector<TrueTypeFont::Line> lines;
+        ScratchArena raster; // coverage and the rasterizer's accumulation
+        ScratchArena field;  // the coverage transform's own scratch
+    };
+
+    // Where a glyph's outline lands in its own bitmap
+    struct Placement
+    {
+        int glyph;
+        float dx, dy;
+    };
+}
+
+bool FontAtlas::bake(const TrueTypeFont& font, float pixelSize, int spread, int maxSize, ThreadPool& pool)
+{
+    std::vector<uint32_t> codepoints;
+    font.codepoints(codepoints);
+    return bake(font, codepoints, pixelSize, spread, maxSize, pool);
+}
+
+bool FontAtlas::bake(const TrueTypeFont& font, const std::vector<uint32_t>& codepoints, float pixelSize, int spread, int maxSize,
+    ThreadPool& pool)
+{
+    TRACE_SCOPE("bakeFontAtlas");
+    const auto start = std::chrono::steady_clock::now();
+    clear();
+    if (font.unitsPerEm() <= 0 || pixelSize <= 0.f || spread < 1)
+        return false;
+
+    const float scale = pixelSize / font.unitsPerEm();
+    m_pixelSize = pixelSize;
+    m_spread = spread;
+    m_ascent = font.ascent() * scale;
+    m_descent = font.descent() * scale;
+    m_lineGap = font.lineGap() * scale;
+
+    std::vector<uint32_t> sorted(codepoints);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    // Metrics and bitmap sizes come from the glyph headers without touching the outlines
+    m_glyphs.resize(sorted.size());
+    std::vector<Placement> placements(sorted.size());
+    std::vector<int> order;
+    order.reserve(sorted.size());
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        Glyph& glyph = m_glyphs[i];
+        Placement& placement = placements[i];
+        placement.glyph = font.glyphIndex(sorted[i]);
+
+        int advance, leftBearing;
+        font.horizontalMetrics(placement.glyph, advance, leftBearing);
+        glyph = {sorted[i], 0, 0, 0, 0, 0.f, 0.f, advance * scale};
+
+        TrueTypeFont::Box box;
+        if (!font.glyphBox(placement.glyph, box))
+            continue;
+
+        const int x0 = int(floorf(box.xMin * scale));
+        const int x1 = int(ceilf(box.xMax * scale));
+        const int y0 = int(floorf(box.yMin * scale));
+        const int y1 = int(ceilf(box.yMax * scale));
+        glyph.width = x1 - x0 + 2 * spread;
+        glyph.height = y1 - y0 + 2 * spread;
+        glyph.left = float(x0 - spread);
+        glyph.top = float(y1 + spread);
+        placement.dx = float(spread - x0);
+        placement.dy = float(spread + y1);
+        order.push_back(int(i));
+    }
+
+    // Tallest first packs the shelves tightly and hands the slowest glyphs out before the rest
+    std::sort(order.begin(), order.end(), [this](int a, int b)
+    {
+        const Glyph& ga = m_glyphs[a];
+        const Glyph& gb = m_glyphs[b];
+        return ga.height != gb.height ? ga.height > gb.height : ga.width > gb.width;
+    });
+    if (!pack(order, maxSize))
+    {
+        clear();
+        return false;
+    }
+
+    // Gaps between glyphs read as far outside
+    m_pixels.assign(size_t(m_width) * m_height, int8_t(-127));
+
+    // NOTE the transform runs serially inside each task; the pool can't take a nested job
+    const int workerCount = std::min(pool.size(), int(order.size()));
+    std::unique_ptr<Worker[]> workers(new Worker[std::max(workerCount, 1)]);
+    std::atomic<int> next(0);
+    std::atomic<bool> failed(false);
+    pool.parallelFor(workerCount, [&](int w)
+    {
+        Worker& worker = workers[w];
+        for (int i = next++; i < int(order.size()); i = next++)
+        {
+            const Glyph& glyph = m_glyphs[order[i]];
+            const Placement& placement = placements[order[i]];
+
+            worker.lines.clear();
+            if (!font.outline(placement.glyph, scale, placement.dx, placement.dy, worker.lines))
+                continue; // malformed outlines are left blank
+
+            const size_t texels = size_t(glyph.width) * glyph.height;
+            uint8_t* memory = worker.raster.get<uint8_t>(ScratchArena::align(texels) + (texels + 2) * sizeof(float));
+            if (!memory)
+            {
+                failed = true;
+                return;
+            }
+            uint8_t* coverage = memory;
+            float* accumulation = reinterpret_cast<float*>(memory + ScratchArena::align(texels));
+            TrueTypeFont::rasterize(worker.lines, glyph.width, glyph.height, accumulation, coverage);
+
+            int8_t* dst = &m_pixels[size_t(glyph.y) * m_width + glyph.x];
+            if (!CoverageTransform::generateClamped(coverage, glyph.width, glyph.height, float(m_spread), dst, m_width, worker.field))
+            {
+                failed = true;
+                return;
+            }
+        }
+    });
+    if (failed)
+    {
+        clear();
+        return false;
+    }
+
+    m_bakeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool FontAtlas::pack(const std::vector<int>& order, int maxSize)
+{
+    size_t area = 0;
+    int widest = 1;
+    for (int i : order)
+    {
+        area += size_t(m_glyphs[i].width) * m_glyphs[i].height;
+        widest = std::max(widest, m_glyphs[i].width);
+    }
+
+    // Start at the smallest power of two that could hold everything and widen until the height fits too
+    int width = 1;
+    while (width < widest || size_t(width) * width < area)
+        width *= 2;
+    for (; width <= maxSize; width *= 2)
+    {
+        // Shelves as tall as their first glyph, filled left to right
+        int x = 0, y = 0, shelfHeight = 0;
+        for (int i : order)
+        {
+            Glyph& glyph = m_glyphs[i];
+            if (x + glyph.width > width)
+            {
+                x = 0;
+                y += shelfHeight;
+                shelfHeight = 0;
+            }
+            glyph.x = x;
+            glyph.y = y;
+            x += glyph.width;
+            shelfHeight = std::max(shelfHeight, glyph.height);
+        }
+
+        const int height = std::max(y + shelfHeight, 1);
+        if (height <= maxSize)
+        {
+            m_width = width;
+            m_height = height;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FontAtlas::clear()
+{
+    m_glyphs.clear();
+    m_pixels.clear();
+    m_width = 0;
+    m_height = 0;
+    m_bakeMs = 0.0;
+}
+
+const FontAtlas::Glyph* FontAtlas::find(uint32_t codepoint) const
+{
+    auto it = std::lower_bound(m_glyphs.begin(), m_glyphs.end(), codepoint, [](const Glyph& glyph, uint32_t value)
+    {
+        return glyph.codepoint < value;
+    });
+    return it != m_glyphs.end() && it->codepoint == codepoint ? &*it : nullptr;
+}
@@ -0,0 +1,67 @@
+#ifndef __FONTATLAS_H__
+#define __FONTATLAS_H__
+
+#include "ThreadPool.h"
+#include "TrueType.h"
+
+#include <cstdint>
+#include <vector>
+
+// Signed distance fields of a font's glyphs packed into one R8 snorm image, with the metrics to lay out text
+// Glyph boxes come straight from the font, so the whole atlas is packed before anything is rasterized and each
+// glyph is then rasterized and transformed straight into its slot. Workers take glyphs one at a time, largest
+// first, each with its own scratch, and the coverage transform keeps the edges accurate to a fraction of a texel.
+class FontAtlas
+{
+public:
+    // Metrics in pixels at the baked size, y up from the baseline
+    struct Glyph
+    {
+        uint32_t codepoint;
+        int x, y, width, height; // atlas rect in texels, including the padding; empty for a blank glyph
+        float left, top;         // pen position to the rect's top left corner
+        float advance;
+    };
+
+private:
+    std::vector<Glyph> m_glyphs; // sorted by code point
+    std::vector<int8_t> m_pixels;
+    int m_width, m_height;
+    float m_pixelSize;
+    int m_spread;
+    float m_ascent, m_descent, m_lineGap;
+    double m_bakeMs;
+
+public:
+    FontAtlas(): m_width(0), m_height(0), m_pixelSize(0.f), m_spread(0), m_ascent(0.f), m_descent(0.f), m_lineGap(0.f),
+        m_bakeMs(0.0) {}
+
+    // Bakes every code point the font maps, or just the given ones; the field reaches spread pixels either side
+    // of the outline, which is also the padding around each glyph. Fails if it won't fit in maxSize x maxSize.
+    bool bake(const TrueTypeFont& font, float pixelSize, int spread, int maxSize, ThreadPool& pool);
+    bool bake(const TrueTypeFont& font, const std::vector<uint32_t>& codepoints, float pixelSize, int spread, int maxSize,
+        ThreadPool& pool);
+
+    void clear();
+
+    // Null if the code point wasn't baked
+    const Glyph* find(uint32_t codepoint) const;
+
+    const std::vector<Glyph>& glyphs() const {return m_glyphs;}
+    const int8_t* pixels() const {return m_pixels.data();}
+    int width() const {return m_width;}
+    int height() const {return m_height;}
+    float pixelSize() const {return m_pixelSize;}
+    int spread() const {return m_spread;}
+    float ascent() const {return m_ascent;}
+    float descent() const {return m_descent;}
+    float lineHeight() const {return m_ascent - m_descent + m_lineGap;}
+
+    // Wall time of the last bake, from reading the metrics to the finished image
+    double bakeMs() const {return m_bakeMs;}
+
+private:
+    bool pack(const std::vector<int>& order, int maxSize);
+};
+
+#endif //__FONTATLAS_H__
@@ -0,0 +1,138 @@
+#include "FrameStats.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+FrameStats::FrameStats(): m_sinceRefresh(0), m_tweakBar(nullptr)
+{
+    std::fill(&m_current[0], &m_current[PHASE_CPU_COUNT], 0.f);
+    std::fill(&m_next[0], &m_next[PHASE_COUNT], 0);
+    std::fill(&m_filled[0], &m_filled[PHASE_COUNT], 0);
+    std::fill(&m_percentiles[0], &m_percentiles[PHASE_COUNT], Percentiles{0.f, 0.f, 0.f});
+}
+
+FrameStats::Clock::time_point FrameStats::lap(Phase phase, Clock::time_point start)
+{
+    const Clock::time_point end = Clock::now();
+    add(phase, std::chrono::duration<double, std::milli>(end - start).count());
+
+    // NOTE Trace reads the same steady clock, so phases line up with the spans recorded elsewhere
+    using std::chrono::nanoseconds;
+    Trace::record(name(phase), std::chrono::duration_cast<nanoseconds>(start.time_since_epoch()).count(),
+        std::chrono::duration_cast<nanoseconds>(end.time_since_epoch()).count());
+    return end;
+}
+
+void FrameStats::endFrame()
+{
+    for (int phase = 0; phase < PHASE_CPU_COUNT; ++phase)
+    {
+        sample(Phase(phase), m_current[phase]);
+        m_current[phase] = 0.f;
+    }
+
+    if (++m_sinceRefresh >= REFRESH_FRAMES)
+    {
+        refresh();
+        m_sinceRefresh = 0;
+    }
+}
+
+void FrameStats::sample(Phase phase, double ms)
+{
+    m_samples[phase][m_next[phase]] = float(ms);
+    m_next[phase] = (m_next[phase] + 1) % SAMPLES;
+    m_filled[phase] = std::min(m_filled[phase] + 1, SAMPLES);
+}
+
+void FrameStats::refresh()
+{
+    // Nearest rank on a sorted copy; 256 floats per phase is cheap at this rate
+    float sorted[SAMPLES];
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        const int filled = m_filled[phase];
+        if (filled == 0)
+            continue;
+
+        std::copy(&m_samples[phase][0], &m_samples[phase][filled], sorted);
+        std::sort(sorted, sorted + filled);
+        m_percentiles[phase] = {percentile(sorted, filled, 0.5f), percentile(sorted, filled, 0.95f), percentile(sorted, filled, 0.99f)};
+    }
+}
+
+void FrameStats::initBar()
+{
+    m_tweakBar = TwNewBar("Timings");
+    TwDefine(" Timings size='170 400' position='180 16' color='224 160 96' fontsize=3 refresh=0.5 ");
+    TwAddVarRO(m_tweakBar, "Frames", TW_TYPE_INT32, &m_filled[PHASE_FRAME], " help='Frames in the histograms' ");
+
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        const char* group = name(Phase(phase));
+        Percentiles& percentiles = m_percentiles[phase];
+        const struct {const char* label; float* value;} rows[] =
+        {
+            {"p50", &percentiles.p50},
+            {"p95", &percentiles.p95},
+            {"p99", &percentiles.p99},
+        };
+
+        // NOTE var names must be unique across the bar, so the label is set separately
+        for (const auto& row : rows)
+        {
+            char varName[64], varDef[96];
+            snprintf(varName, sizeof(varName), "%s %s", group, row.label);
+            snprintf(varDef, sizeof(varDef), " label='%s ms' group='%s' precision=3 ", row.label, group);
+            TwAddVarRO(m_tweakBar, varName, TW_TYPE_FLOAT, row.value, varDef);
+        }
+    }
+}
+
+void FrameStats::closeBar()
+{
+    if (m_tweakBar)
+    {
+        TwDeleteBar(m_tweakBar);
+        m_tweakBar = nullptr;
+    }
+}
+
+float FrameStats::percentile(const float* sorted, int count, float p)
+{
+    return count > 0 ? sorted[std::min(std::max(int(ceilf(p * count)) - 1, 0), count - 1)] : 0.f;
+}
+
+const char* FrameStats::name(Phase phase)
+{
+    switch (phase)
+    {
+        case PHASE_PREPARE: return "Prepare";
+        case PHASE_CLEAR: return "Clear";
+        case PHASE_RENDER: return "Render";
+        case PHASE_TWDRAW: return "TwDraw";
+        case PHASE_SWAP: return "Swap";
+        case PHASE_POLL: return "Poll";
+        case PHASE_UPDATE: return "Update";
+        case PHASE_FRAME: return "Frame";
+        case PHASE_GPU_UPLOAD: return "GPU Upload";
+        case PHASE_GPU_DRAW: return "GPU Draw";
+        default: return "Unknown";
+    }
+}
+
+void RunSummary::print(double seconds, uint32_t bakes) const
+{
+    const int frames = this->frames();
+    std::vector<float> sorted(m_frameMs);
+    std::sort(sorted.begin(), sorted.end());
+
+    printf("Frames: %d in %.3fs\n", frames, seconds);
+    printf("Mean fps: %.1f\n", seconds > 0.0 ? frames / seconds : 0.0);
+    printf("Frame ms: p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n",
+        FrameStats::percentile(sorted.data(), frames, 0.5f), FrameStats::percentile(sorted.data(), frames, 0.95f),
+        FrameStats::percentile(sorted.data(), frames, 0.99f), frames > 0 ? sorted.back() : 0.f);
+    printf("Bakes: %u (%.1f/s)\n", bakes, seconds > 0.0 ? bakes / seconds : 0.0);
+}
@@ -0,0 +1,96 @@
+#ifndef __FRAMESTATS_H__
+#define __FRAMESTATS_H__
+
+#include <AntTweakBar.h>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Per-phase CPU timings of the last SAMPLES frames, with percentiles shown in a tweak bar
+// NOTE GL calls only queue work, so GPU time mostly lands in whichever phase blocks on it (usually swap)
+class FrameStats
+{
+public:
+    enum Phase : int
+    {
+        PHASE_PREPARE, // scene prepare, where bakes and uploads happen
+        PHASE_CLEAR,
+        PHASE_RENDER,
+        PHASE_TWDRAW,
+        PHASE_SWAP,
+        PHASE_POLL,
+        PHASE_UPDATE, // all ticks run this frame
+        PHASE_FRAME,  // whole frame, start to start
+        PHASE_GPU_UPLOAD, // GPU timer results, sampled whenever a readback completes
+        PHASE_GPU_DRAW,
+        PHASE_COUNT,
+        PHASE_CPU_COUNT = PHASE_GPU_UPLOAD
+    };
+
+    struct Percentiles {float p50, p95, p99;};
+
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr int SAMPLES = 256;
+
+    // Percentiles are recomputed this often rather than every frame
+    static constexpr int REFRESH_FRAMES = 30;
+
+private:
+    float m_samples[PHASE_COUNT][SAMPLES]; // ms
+    float m_current[PHASE_CPU_COUNT];
+    Percentiles m_percentiles[PHASE_COUNT];
+    int m_next[PHASE_COUNT];
+    int m_filled[PHASE_COUNT];
+    int m_sinceRefresh;
+    TwBar* m_tweakBar;
+
+public:
+    FrameStats();
+    ~FrameStats() {closeBar();}
+
+    FrameStats(const FrameStats&) = delete;
+    FrameStats& operator=(const FrameStats&) = delete;
+
+    // Adds the time since start to the phase for this frame and returns the current time
+    Clock::time_point lap(Phase phase, Clock::time_point start);
+    void add(Phase phase, double ms) {m_current[phase] += float(ms);}
+
+    // Commits this frame's CPU phase times to the histograms
+    void endFrame();
+
+    // Adds one sample straight to a phase's histogram; for results that don't arrive every frame
+    void sample(Phase phase, double ms);
+
+    const Percentiles& percentiles(Phase phase) const {return m_percentiles[phase];}
+    int samples(Phase phase) const {return m_filled[phase];}
+
+    void initBar();
+    void closeBar();
+
+    static Clock::time_point now() {return Clock::now();}
+    static const char* name(Phase phase);
+
+    // Nearest rank percentile of count sorted samples
+    static float percentile(const float* sorted, int count, float p);
+
+private:
+    void refresh();
+};
+
+// Every frame time of a benchmark run, for the summary printed at exit
+class RunSummary
+{
+private:
+    std::vector<float> m_frameMs;
+
+public:
+    // NOTE reserve the expected frame count so recording never allocates mid-run
+    void reserve(int frames) {m_frameMs.reserve(frames);}
+    void addFrame(double ms) {m_frameMs.push_back(float(ms));}
+    int frames() const {return int(m_frameMs.size());}
+
+    void print(double seconds, uint32_t bakes) const;
+};
+
+#endif //__FRAMESTATS_H__
@@ -1,7 +1,9 @@
 #include "GlfwInstance.h"
+#include "Trace.h"
 
 #include <AntTweakBar.h>
 #include <cstdio>
+#include <cmath>
 
 bool GlfwInstance::init(const char* name, int width, int height)
 {
@@ -28,6 +30,7 @@ bool GlfwInstance::init(const char* name, int width, int height)
     }
 
     glfwSetWindowUserPointer(m_window, this);
+    m_title = name;
 
     // Set GLFW callbacks
     glfwSetKeyCallback(m_window, callback_key);
@@ -35,11 +38,12 @@ bool GlfwInstance::init(const char* name, int width, int height)
     glfwSetMouseButtonCallback(m_window, callback_mouse_button);
     //glfwSetScrollCallback(m_window, scrollCallback);
     glfwSetWindowSizeCallback(m_window, callback_window);
+    glfwSetWindowRefreshCallback(m_window, callback_refresh);
     //glfwSetFramebufferSizeCallback(m_window, resizeCallback);
 
-    // Force vsync on current context
+    // Vsync on unless we're measuring throughput
     glfwMakeContextCurrent(m_window);
-    glfwSwapInterval(1);
+    glfwSwapInterval(m_vsync ? 1 : 0);
     
     // Send an initial resize notification to scene
     //int width, height;
@@ -48,6 +52,7 @@ bool GlfwInstance::init(const char* name, int width, int height)
 
     // Initialize AntTweakBar
     TwInit(TW_OPENGL_CORE, nullptr);
+    m_stats.initBar();
 
     return true;
 }
@@ -56,32 +61,144 @@ void GlfwInstance::close()
 {
     if (m_window)
     {
+        m_stats.closeBar();
+        m_drawTimer.release();
         TwTerminate();
         glfwTerminate();
         m_window = nullptr;
     }
 }
 
+void GlfwInstance::addScene(Scene* scene)
+{
+    scene->setFrameStats(&m_stats);
+    m_scenes.push_back(scene);
+    if (m_requestedScene < 0)
+        m_requestedScene = 0;
+}
+
+void GlfwInstance::selectScene(int index)
+{
+    if (index >= 0 && index < int(m_scenes.size()))
+        m_requestedScene = index;
+}
+
+void GlfwInstance::preloadScenes()
+{
+    TRACE_SCOPE("Preload");
+
+    // Draw every scene once into the back buffer, which is never shown, so that drivers that compile
+    // shaders lazily on first use do it now rather than on the frame we switch
+    for (Scene* scene : m_scenes)
+    {
+        scene->setActive(false);
+        scene->preload();
+        scene->render(0.0);
+    }
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glFinish();
+
+    switchScene();
+}
+
+void GlfwInstance::switchScene()
+{
+    if (m_scene)
+        m_scene->setActive(false);
+
+    m_sceneIndex = m_requestedScene;
+    m_scene = m_sceneIndex >= 0 ? m_scenes[m_sceneIndex] : nullptr;
+    if (!m_scene)
+        return;
+
+    m_scene->setActive(true);
+
+    std::string title = m_title;
+    if (*m_scene->name())
+        title = title + " - " + m_scene->name();
+    glfwSetWindowTitle(m_window, title.c_str());
+}
+
 void GlfwInstance::run()
 {
     // The first event poll will take extra time; get it out of the way first
     glfwPollEvents();
-    
-    // TODO make sure to preload scene resources so we get off to a clean start?
+
+    Trace::setThreadName("Main");
+    preloadScenes();
+
+    const double tickTime = 1.0 / m_tickRate;
+    double tickAccumulator = 0.0;
+
+    const bool limited = m_frameLimit > 0 || m_timeLimit > 0.0;
+    RunSummary summary;
+    if (m_frameLimit > 0)
+        summary.reserve(m_frameLimit);
 
     double lastTime = glfwGetTime();
+    const double startTime = lastTime;
+    FrameStats::Clock::time_point frameStart = FrameStats::now();
+    bool redraw = true;
     while (!glfwWindowShouldClose(m_window))
     {
+        if (m_onDemand && !redraw)
+        {
+            // Nothing will change until something wakes us, so don't spend a frame finding that out
+            // NOTE GLFW 3.1 has no glfwWaitEventsTimeout; nothing here has a deadline while idle, and
+            // other threads wake the loop with glfwPostEmptyEvent through Scene::requestRedraw
+            {
+                TRACE_SCOPE("Wait");
+                glfwWaitEvents();
+            }
+
+            // Time spent asleep isn't frame time, and the scene shouldn't tick to catch up on it
+            lastTime = glfwGetTime();
+            tickAccumulator = 0.0;
+            frameStart = FrameStats::now();
+        }
+        m_inputSeen = false;
+
+        if (m_requestedScene != m_sceneIndex)
+            switchScene();
+
+        FrameStats::Clock::time_point time = frameStart;
+
+        float gpuMs = 0.f;
+        if (m_drawTimer.resolve(gpuMs))
+            m_stats.sample(FrameStats::PHASE_GPU_DRAW, gpuMs);
+
+        const double alpha = tickAccumulator / tickTime;
+        if (m_scene)
+            m_scene->prepare(alpha);
+        if (m_backgroundScenes)
+        {
+            for (Scene* scene : m_scenes)
+            {
+                if (scene != m_scene)
+                    scene->prepare(alpha);
+            }
+        }
+        time = m_stats.lap(FrameStats::PHASE_PREPARE, time);
+
         int width, height;
         glfwGetFramebufferSize(m_window, &width, &height);
         glViewport(0, 0, width, height);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        time = m_stats.lap(FrameStats::PHASE_CLEAR, time);
 
         // Render scene
+        m_drawTimer.begin();
         if (m_scene)
-            m_scene->render();
+            m_scene->render(alpha);
+        m_drawTimer.end();
+        time = m_stats.lap(FrameStats::PHASE_RENDER, time);
+
+        // Draw tweak bars on top
+        TwDraw();
+        time = m_stats.lap(FrameStats::PHASE_TWDRAW, time);
 
         glfwSwapBuffers(m_window);
+        time = m_stats.lap(FrameStats::PHASE_SWAP, time);
 
         // Compute elapsed time since last update
         // TODO: check for overflow
@@ -91,11 +208,46 @@ void GlfwInstance::run()
 
         // Poll events after checking time for consistency
         glfwPollEvents();
+        time = m_stats.lap(FrameStats::PHASE_POLL, time);
 
-        // Update scene
-        if (m_scene)
-            m_scene->update(elapsedTime);
+        // Update scene at a fixed rate
+        tickAccumulator += m_fixedStep ? tickTime : elapsedTime;
+        for (int ticks = 0; tickAccumulator >= tickTime && ticks < m_maxTicksPerFrame; ++ticks)
+        {
+            for (Scene* scene : m_scenes)
+            {
+                if (scene == m_scene || m_backgroundScenes)
+                    scene->update(tickTime);
+            }
+            tickAccumulator -= tickTime;
+        }
+
+        // After a hitch, drop the time we couldn't catch up on rather than falling further behind
+        if (tickAccumulator >= tickTime)
+            tickAccumulator = fmod(tickAccumulator, tickTime);
+        time = m_stats.lap(FrameStats::PHASE_UPDATE, time);
+
+        const FrameStats::Clock::time_point frameEnd = m_stats.lap(FrameStats::PHASE_FRAME, frameStart);
+        const double frameMs = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+        m_stats.endFrame();
+        frameStart = time;
+
+        if (limited)
+        {
+            summary.addFrame(frameMs);
+            if ((m_frameLimit > 0 && summary.frames() >= m_frameLimit) ||
+                (m_timeLimit > 0.0 && currentTime - startTime >= m_timeLimit))
+                glfwSetWindowShouldClose(m_window, GL_TRUE);
+        }
+
+        // NOTE any input redraws, since the tweak bar highlights what's under the cursor
+        redraw = m_inputSeen || !m_scene || m_scene->animating() || m_requestedScene != m_sceneIndex;
+        if (m_scene && m_scene->takeRedrawRequest())
+            redraw = true;
     }
+
+    if (limited)
+        summary.print(glfwGetTime() - startTime, m_scene ? m_scene->bakes() : 0);
 }
 
 void GlfwInstance::callback_error(int error, const char* description)
@@ -105,6 +257,8 @@ void GlfwInstance::callback_error(int error, const char* description)
 
 void GlfwInstance::callback_key(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+    reinterpret_cast<GlfwInstance*>(glfwGetWindowUserPointer(window))->m_inputSeen = true;
+
     // TODO add flag for if scene has mouse focus/priority for events
     if (TwEventKeyGLFW(key, action))
         return;
@@ -132,11 +286,27 @@ void GlfwInstance::callback_key(GLFWwindow* window, int key, int scancode, int a
         // If key is unhandled, provide default behavior for escape
         if (key == GLFW_KEY_ESCAPE)
             glfwSetWindowShouldClose(window, GL_TRUE);
+
+        // NOTE the pool is idle between frames, so no worker is mid-span
+        if (key == TRACE_KEY && action == GLFW_PRESS)
+        {
+            auto instance = reinterpret_cast<GlfwInstance*>(glfwGetWindowUserPointer(window));
+            Trace::dump(instance->tracePath());
+        }
+
+        if (key == SCENE_KEY && action == GLFW_PRESS)
+        {
+            auto instance = reinterpret_cast<GlfwInstance*>(glfwGetWindowUserPointer(window));
+            if (!instance->m_scenes.empty())
+                instance->selectScene((instance->m_requestedScene + 1) % int(instance->m_scenes.size()));
+        }
     }
 }
 
 void GlfwInstance::callback_mouse_button(GLFWwindow* window, int button, int action, int mods)
 {
+    reinterpret_cast<GlfwInstance*>(glfwGetWindowUserPointer(window))->m_inputSeen = true;
+
     // TODO add flag for if scene has mouse focus/priority for events
     if (TwEventMouseButtonGLFW(button, action))
         return;
@@ -169,6 +339,7 @@ void GlfwInstance::callback_mouse_motion(GLFWwindow* window, double xpos, double
 {
     void* ptr = glfwGetWindowUserPointer(window);
     auto instance = reinterpret_cast<GlfwInstance*>(ptr);
+    instance->m_inputSeen = true;
     
     float& fbScaleX = instance->m_fbScale.x;
     float& fbScaleY = instance->m_fbScale.y;
@@ -181,6 +352,7 @@ void GlfwInstance::callback_window(GLFWwindow* window, int width, int height)
 {
     void* ptr = glfwGetWindowUserPointer(window);
     auto instance = reinterpret_cast<GlfwInstance*>(ptr);
+    instance->m_inputSeen = true;
 
     /*if (instance && instance->m_scene)
         instance->m_scene->resize(width, height);*/
@@ -193,3 +365,9 @@ void GlfwInstance::callback_window(GLFWwindow* window, int width, int height)
     // AntTweakBar stupidly doesn't handle DPI scaling, so must use raw framebuffer size
     TwWindowSize(fbWidth, fbHeight);
 }
+
+void GlfwInstance::callback_refresh(GLFWwindow* window)
+{
+    // The window was exposed or resized and its contents are stale
+    reinterpret_cast<GlfwInstance*>(glfwGetWindowUserPointer(window))->m_inputSeen = true;
+}
@@ -4,13 +4,61 @@
 #define GLFW_INCLUDE_GLCOREARB
 #include <GLFW/glfw3.h>
 
+#include "FrameStats.h"
+#include "GpuTimer.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
 class Scene
 {
+private:
+    std::atomic<bool> m_redrawRequested{true};
+
+protected:
+    // Owned by the instance running the scene; null when running headless
+    FrameStats* m_frameStats = nullptr;
+
+    // Asks for another frame even if nothing else changed; safe to call from any thread
+    void requestRedraw() {if (!m_redrawRequested.exchange(true)) glfwPostEmptyEvent();}
+
 public:
     virtual ~Scene() {}
+
+    void setFrameStats(FrameStats* frameStats) {m_frameStats = frameStats;}
+    bool takeRedrawRequest() {return m_redrawRequested.exchange(false);}
+
+    // While true, every frame may differ from the last, so on-demand rendering draws continuously
+    virtual bool animating() const {return true;}
+
+    // Sets up GL resources once there's a context; returning false aborts startup
+    virtual bool init() {return true;}
+
+    // Releases them while the context is still current
+    virtual void close() {}
+
+    // Fields baked so far, for throughput summaries
+    virtual uint32_t bakes() const {return 0;}
+
+    // Shown in the window title while the scene is active
+    virtual const char* name() const {return "";}
+
+    // Called before the first frame so switching to the scene never has to bake or compile
+    // NOTE the default runs one frame's worth of work; the instance draws it once and throws it away
+    virtual void preload() {prepare(0.0);}
+
+    // Only the active scene is drawn; others hide their UI
+    virtual void setActive(bool active) {}
     
-    virtual void render() = 0;
-    virtual void update(double elapsedTime) = 0;
+    // Called once per frame before render; the place to apply changes batched up since the last frame
+    virtual void prepare(double alpha) {}
+
+    // alpha is how far into the next tick we are, for interpolating between the last two updates
+    virtual void render(double alpha) = 0;
+
+    // Called at a fixed rate with the tick length, however fast frames are rendered
+    virtual void update(double tickTime) = 0;
 };
 
 class GlfwInstance
@@ -18,24 +66,85 @@ class GlfwInstance
 private:
     struct {float x, y;} m_fbScale;
     GLFWwindow* m_window;
-    Scene* m_scene;
+    std::vector<Scene*> m_scenes;
+    Scene* m_scene; // the active one
+    int m_sceneIndex;
+    int m_requestedScene;
+    bool m_backgroundScenes;
+    std::string m_title;
+    double m_tickRate;
+    int m_maxTicksPerFrame;
+    FrameStats m_stats;
+    GpuTimer m_drawTimer;
+    std::string m_tracePath;
+    bool m_onDemand;
+    bool m_inputSeen;
+    bool m_vsync;
+    bool m_fixedStep;
+    int m_frameLimit;
+    double m_timeLimit;
 
 public:
-    GlfwInstance(): m_window(nullptr), m_scene(nullptr) {}
+    GlfwInstance(): m_window(nullptr), m_scene(nullptr), m_sceneIndex(-1), m_requestedScene(-1),
+        m_backgroundScenes(false), m_tickRate(DEFAULT_TICK_RATE),
+        m_maxTicksPerFrame(DEFAULT_MAX_TICKS), m_tracePath(DEFAULT_TRACE_PATH),
+        m_onDemand(true), m_inputSeen(false), m_vsync(true), m_fixedStep(false), m_frameLimit(0), m_timeLimit(0.0) {}
     ~GlfwInstance() {close();}
 
-    // TODO maintain list of scenes that can be toggled between?
-    void setScene(Scene* scene) {m_scene = scene;}
+    // Scenes are preloaded when run starts and switched between with SCENE_KEY; the first added is active
+    void addScene(Scene* scene);
+
+    // Takes effect at the start of the next frame
+    void selectScene(int index);
+
+    // Keep ticking and baking inactive scenes so they're current when switched to
+    void setBackgroundScenes(bool background) {m_backgroundScenes = background;}
+
+    // Scene updates per second, and how many may run after one slow frame before time is dropped
+    void setTickRate(double tickRate) {m_tickRate = tickRate;}
+    void setMaxTicksPerFrame(int maxTicks) {m_maxTicksPerFrame = maxTicks;}
+
+    // Sleep in glfwWaitEvents instead of redrawing when there's no input, redraw request or animation
+    void setOnDemand(bool onDemand) {m_onDemand = onDemand;}
+
+    // Must be set before init
+    void setVsync(bool vsync) {m_vsync = vsync;}
+
+    // Advance exactly one tick per frame, whatever the wall time, so runs are repeatable
+    void setFixedStep(bool fixedStep) {m_fixedStep = fixedStep;}
+
+    // Close after this many frames or seconds; 0 for no limit. A limited run prints a summary at exit
+    void setFrameLimit(int frames) {m_frameLimit = frames;}
+    void setTimeLimit(double seconds) {m_timeLimit = seconds;}
+
+    const FrameStats& stats() const {return m_stats;}
+
+    // Where the trace hotkey writes the timeline
+    void setTracePath(const char* path) {m_tracePath = path;}
+    const char* tracePath() const {return m_tracePath.c_str();}
 
     bool init(const char* name, int width, int height);
     void close();
     void run();
 
+    // NOTE matches the effective rate of the old update loop, which waited 0.1s between steps
+    static constexpr double DEFAULT_TICK_RATE = 10.0;
+    static constexpr int DEFAULT_MAX_TICKS = 5;
+
+    static constexpr const char* const DEFAULT_TRACE_PATH = "trace.json";
+    static constexpr int TRACE_KEY = GLFW_KEY_F9;
+    static constexpr int SCENE_KEY = GLFW_KEY_TAB;
+
     static void callback_error(int error, const char* description);
     static void callback_key(GLFWwindow* window, int key, int scancode, int action, int mods);
     static void callback_mouse_button(GLFWwindow* window, int button, int action, int mods);
     static void callback_mouse_motion(GLFWwindow* window, double xpos, double ypos);
     static void callback_window(GLFWwindow* window, int width, int height);
+    static void callback_refresh(GLFWwindow* window);
+
+private:
+    void preloadScenes();
+    void switchScene();
 };
 
 #endif //__GLFWINSTANCE_H__
@@ -0,0 +1,90 @@
+#include "GpuTimer.h"
+
+GpuTimer* GpuTimer::s_running = nullptr;
+
+bool GpuTimer::resolve(float& ms)
+{
+    // Close out last frame's queries and move on to the oldest frame's slot
+    Frame& last = m_frames[m_current];
+    if (last.used > 0)
+        last.pending = true;
+    m_current = (m_current + 1) % FRAMES;
+
+    Frame& frame = m_frames[m_current];
+    if (!frame.pending)
+        return false;
+
+    // NOTE if the results are late, the slot stays pending and this frame goes unmeasured
+    for (int i = 0; i < frame.used; ++i)
+    {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+
+    GLuint64 total = 0;
+    for (int i = 0; i < frame.used; ++i)
+    {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &elapsed);
+        total += elapsed;
+    }
+
+    frame.used = 0;
+    frame.pending = false;
+
+    // NOTE llvmpipe reports garbage for the first query in a context; no frame can take longer on the
+    // GPU than has passed since it was issued, so anything that does is dropped
+    const double wallNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - frame.issued).count();
+    if (double(total) > wallNs)
+        return false;
+
+    m_ms = float(total * 1e-6);
+    ms = m_ms;
+    return true;
+}
+
+void GpuTimer::begin()
+{
+    Frame& frame = m_frames[m_current];
+    if (s_running || frame.pending)
+        return;
+
+    if (frame.used == int(frame.queries.size()))
+    {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+
+    if (frame.used == 0)
+        frame.issued = std::chrono::steady_clock::now();
+
+    glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.used++]);
+    m_running = true;
+    s_running = this;
+}
+
+void GpuTimer::end()
+{
+    if (!m_running)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_running = false;
+    s_running = nullptr;
+}
+
+void GpuTimer::release()
+{
+    end();
+    for (Frame& frame : m_frames)
+    {
+        if (!frame.queries.empty())
+            glDeleteQueries(GLsizei(frame.queries.size()), frame.queries.data());
+        frame.queries.clear();
+        frame.used = 0;
+        frame.pending = false;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef __GPUTIMER_H__
+#define __GPUTIMER_H__
+
+// NOTE GLFW directly rather than GlfwInstance.h, which includes this
+#define GLFW_INCLUDE_GLCOREARB
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <vector>
+
+// GPU time of the work between begin and end, summed over a frame and read back frames later
+// NOTE only one GL_TIME_ELAPSED query may be active at a time, so timers must never overlap;
+// a begin while another timer is running is ignored rather than raising a GL error
+class GpuTimer
+{
+public:
+    // Frames of queries in flight; results are read back this many frames after they're issued
+    static constexpr int FRAMES = 2;
+
+private:
+    struct Frame
+    {
+        std::vector<GLuint> queries;
+        int used;
+        bool pending; // ended and waiting on results
+        std::chrono::steady_clock::time_point issued; // first begin of the frame
+    };
+
+    Frame m_frames[FRAMES];
+    int m_current;
+    bool m_running;
+    float m_ms;
+
+    static GpuTimer* s_running;
+
+public:
+    GpuTimer(): m_frames(), m_current(0), m_running(false), m_ms(0.f) {}
+    ~GpuTimer() {release();}
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // Call once per frame before any begin; returns true with the total of an older frame once
+    // all of its queries are available, without ever waiting on them
+    bool resolve(float& ms);
+
+    void begin();
+    void end();
+
+    // Last resolved result
+    float ms() const {return m_ms;}
+
+    void release();
+};
+
+#endif //__GPUTIMER_H__
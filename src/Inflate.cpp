@@ -0,0 +1,383 @@
+#include "Inflate.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// Codes up to this long are decoded with one table lookup, longer ones bit by bit
+static constexpr int FAST_BITS = 9;
+static constexpr uint32_t FAST_MASK = (1 << FAST_BITS) - 1;
+
+// Furthest back a match may reach
+static constexpr size_t WINDOW_SIZE = 32768;
+
+static const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+    67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+    5, 5, 5, 5, 0};
+static const uint16_t DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10,
+    11, 11, 12, 12, 13, 13};
+
+// Order the code length code's own lengths are stored in
+static const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+static int reverseBits(int bits, int count)
+{
+    int reversed = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        reversed = (reversed << 1) | (bits & 1);
+        bits >>= 1;
+    }
+    return reversed;
+}
+
+namespace
+{
+    // Canonical Huffman code; codes are stored bit reversed in the stream, so the table is indexed that way
+    struct Huffman
+    {
+        uint16_t fast[1 << FAST_BITS]; // length << 9 | symbol, or 0 for a longer code
+        uint16_t firstCode[16];
+        uint16_t firstSymbol[16];
+        int32_t maxCode[17]; // one past the last code of each length, shifted up to 16 bits
+        uint8_t size[288];
+        uint16_t value[288];
+
+        bool build(const uint8_t* lengths, int count)
+        {
+            int sizes[16] = {};
+            for (int i = 0; i < count; ++i)
+                ++sizes[lengths[i]];
+            sizes[0] = 0;
+
+            int nextCode[16] = {};
+            int code = 0, symbol = 0;
+            for (int i = 1; i < 16; ++i)
+            {
+                if (sizes[i] > (1 << i))
+                    return false;
+                nextCode[i] = code;
+                firstCode[i] = uint16_t(code);
+                firstSymbol[i] = uint16_t(symbol);
+                code += sizes[i];
+                if (sizes[i] && code - 1 >= (1 << i))
+                    return false;
+                maxCode[i] = code << (16 - i);
+                code <<= 1;
+                symbol += sizes[i];
+            }
+            maxCode[16] = 0x10000;
+
+            memset(fast, 0, sizeof(fast));
+            for (int i = 0; i < count; ++i)
+            {
+                const int length = lengths[i];
+                if (!length)
+                    continue;
+                const int index = nextCode[length] - firstCode[length] + firstSymbol[length];
+                size[index] = uint8_t(length);
+                value[index] = uint16_t(i);
+                if (length <= FAST_BITS)
+                {
+                    for (int j = reverseBits(nextCode[length], length); j < (1 << FAST_BITS); j += 1 << length)
+                        fast[j] = uint16_t(length << 9 | i);
+                }
+                ++nextCode[length];
+            }
+            return true;
+        }
+    };
+
+    class Decoder
+    {
+        const Inflate::Source& m_source;
+        const Inflate::Sink& m_sink;
+
+        const uint8_t* m_in;
+        const uint8_t* m_inEnd;
+        bool m_inputDone;
+        int m_overrun; // zero bytes fed in after the input ran out
+
+        uint32_t m_bits;
+        int m_bitCount;
+
+        // Twice the window so matches never wrap; the older half is kept each time it fills
+        std::vector<uint8_t> m_window;
+        size_t m_out;
+        size_t m_flushed;
+        size_t m_total;
+
+        Huffman m_literals;
+        Huffman m_distances;
+
+    public:
+        Decoder(const Inflate::Source& source, const Inflate::Sink& sink): m_source(source), m_sink(sink),
+            m_in(nullptr), m_inEnd(nullptr), m_inputDone(false), m_overrun(0), m_bits(0), m_bitCount(0),
+            m_window(2 * WINDOW_SIZE), m_out(0), m_flushed(0), m_total(0) {}
+
+        bool run()
+        {
+            // zlib header: deflate with a window of at most 32K and no preset dictionary
+            const uint32_t cmf = getBits(8);
+            const uint32_t flg = getBits(8);
+            if ((cmf * 256 + flg) % 31 != 0 || (cmf & 15) != 8 || (cmf >> 4) > 7 || (flg & 32))
+                return false;
+
+            bool final = false;
+            while (!final)
+            {
+                final = getBits(1) != 0;
+                const uint32_t type = getBits(2);
+                bool ok = false;
+                if (type == 0)
+                    ok = storedBlock();
+                else if (type == 1)
+                    ok = fixedCodes() && huffmanBlock();
+                else if (type == 2)
+                    ok = dynamicCodes() && huffmanBlock();
+                if (!ok || exhausted())
+                    return false;
+            }
+
+            return flush();
+        }
+
+    private:
+        uint8_t nextByte()
+        {
+            while (m_in == m_inEnd)
+            {
+                size_t size = 0;
+                if (m_inputDone || !m_source(m_in, size))
+                {
+                    m_inputDone = true;
+                    ++m_overrun;
+                    return 0;
+                }
+                m_inEnd = m_in + size;
+            }
+            return *m_in++;
+        }
+
+        void fill()
+        {
+            while (m_bitCount <= 24)
+            {
+                m_bits |= uint32_t(nextByte()) << m_bitCount;
+                m_bitCount += 8;
+            }
+        }
+
+        // True once bits past the end of the input have been used
+        bool exhausted() const
+        {
+            return m_bitCount < m_overrun * 8;
+        }
+
+        uint32_t getBits(int count)
+        {
+            if (m_bitCount < count)
+                fill();
+            const uint32_t bits = m_bits & ((1u << count) - 1);
+            m_bits >>= count;
+            m_bitCount -= count;
+            return bits;
+        }
+
+        int decode(const Huffman& huffman)
+        {
+            if (m_bitCount < 16)
+                fill();
+
+            const int fast = huffman.fast[m_bits & FAST_MASK];
+            if (fast)
+            {
+                const int length = fast >> 9;
+                m_bits >>= length;
+                m_bitCount -= length;
+                return fast & 511;
+            }
+
+            const int code = reverseBits(int(m_bits & 0xFFFF), 16);
+            int length = FAST_BITS + 1;
+            while (code >= huffman.maxCode[length])
+                ++length;
+            if (length >= 16)
+                return -1;
+
+            const int index = (code >> (16 - length)) - huffman.firstCode[length] + huffman.firstSymbol[length];
+            if (index >= 288 || huffman.size[index] != length)
+                return -1;
+            m_bits >>= length;
+            m_bitCount -= length;
+            return huffman.value[index];
+        }
+
+        bool flush()
+        {
+            const bool ok = m_out == m_flushed || m_sink(&m_window[m_flushed], m_out - m_flushed);
+            m_flushed = m_out;
+            return ok;
+        }
+
+        // Hands the filled window to the sink and keeps the last 32K for matches to refer back to
+        bool slide()
+        {
+            if (!flush())
+                return false;
+            memmove(&m_window[0], &m_window[m_out - WINDOW_SIZE], WINDOW_SIZE);
+            m_out = WINDOW_SIZE;
+            m_flushed = WINDOW_SIZE;
+            return true;
+        }
+
+        bool put(uint8_t byte)
+        {
+            if (m_out == m_window.size() && !slide())
+                return false;
+            m_window[m_out++] = byte;
+            ++m_total;
+            return true;
+        }
+
+        bool copy(size_t length, size_t dist)
+        {
+            if (dist > m_total)
+                return false;
+            m_total += length;
+            while (length > 0)
+            {
+                if (m_out == m_window.size() && !slide())
+                    return false;
+
+                // NOTE byte by byte on purpose; a match may overlap what it's writing
+                const size_t count = std::min(length, m_window.size() - m_out);
+                uint8_t* out = &m_window[m_out];
+                for (size_t i = 0; i < count; ++i)
+                    out[i] = out[i - dist];
+                m_out += count;
+                length -= count;
+            }
+            return true;
+        }
+
+        bool storedBlock()
+        {
+            getBits(m_bitCount & 7);
+            const uint32_t length = getBits(16);
+            const uint32_t inverse = getBits(16);
+            if ((length ^ 0xFFFF) != inverse)
+                return false;
+            for (uint32_t i = 0; i < length; ++i)
+            {
+                if (!put(uint8_t(getBits(8))))
+                    return false;
+            }
+            return true;
+        }
+
+        bool fixedCodes()
+        {
+            uint8_t lengths[288];
+            memset(lengths, 8, 144);
+            memset(lengths + 144, 9, 112);
+            memset(lengths + 256, 7, 24);
+            memset(lengths + 280, 8, 8);
+            uint8_t distLengths[30];
+            memset(distLengths, 5, sizeof(distLengths));
+            return m_literals.build(lengths, 288) && m_distances.build(distLengths, 30);
+        }
+
+        bool dynamicCodes()
+        {
+            const int literalCount = getBits(5) + 257;
+            const int distCount = getBits(5) + 1;
+            const int codeLengthCount = getBits(4) + 4;
+
+            // The header can count up to 288 literals and 32 distances, but the last two of each are never valid
+            if (literalCount > 286 || distCount > 30)
+                return false;
+
+            uint8_t codeLengthLengths[19] = {};
+            for (int i = 0; i < codeLengthCount; ++i)
+                codeLengthLengths[CODE_LENGTH_ORDER[i]] = uint8_t(getBits(3));
+            Huffman codeLengths;
+            if (!codeLengths.build(codeLengthLengths, 19))
+                return false;
+
+            // Literal and distance lengths are one sequence, and a repeat may run from one into the other
+            uint8_t lengths[286 + 30];
+            const int total = literalCount + distCount;
+            int count = 0;
+            while (count < total)
+            {
+                const int symbol = decode(codeLengths);
+                if (symbol < 0 || exhausted())
+                    return false;
+                if (symbol < 16)
+                {
+                    lengths[count++] = uint8_t(symbol);
+                    continue;
+                }
+
+                uint8_t fill = 0;
+                int repeat = 0;
+                if (symbol == 16)
+                {
+                    if (count == 0)
+                        return false;
+                    fill = lengths[count - 1];
+                    repeat = 3 + getBits(2);
+                }
+                else if (symbol == 17)
+                    repeat = 3 + getBits(3);
+                else
+                    repeat = 11 + getBits(7);
+                if (count + repeat > total)
+                    return false;
+                memset(lengths + count, fill, repeat);
+                count += repeat;
+            }
+
+            return m_literals.build(lengths, literalCount) && m_distances.build(lengths + literalCount, distCount);
+        }
+
+        bool huffmanBlock()
+        {
+            while (true)
+            {
+                int symbol = decode(m_literals);
+                if (symbol < 0 || exhausted())
+                    return false;
+                if (symbol < 256)
+                {
+                    if (!put(uint8_t(symbol)))
+                        return false;
+                    continue;
+                }
+                if (symbol == 256)
+                    return true;
+
+                symbol -= 257;
+                if (symbol >= 29)
+                    return false;
+                const size_t length = LENGTH_BASE[symbol] + getBits(LENGTH_EXTRA[symbol]);
+                const int distSymbol = decode(m_distances);
+                if (distSymbol < 0 || distSymbol >= 30)
+                    return false;
+                const size_t dist = DIST_BASE[distSymbol] + getBits(DIST_EXTRA[distSymbol]);
+                if (!copy(length, dist))
+                    return false;
+            }
+        }
+    };
+}
+
+bool Inflate::zlib(const Source& source, const Sink& sink)
+{
+    Decoder decoder(source, sink);
+    return decoder.run();
+}
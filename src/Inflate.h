@@ -0,0 +1,25 @@
+#ifndef __INFLATE_H__
+#define __INFLATE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Streaming decoder for zlib wrapped DEFLATE data (RFC 1950 and 1951), as found in PNG files
+// Compressed input is pulled from the source a piece at a time and output is pushed to the sink as soon as
+// the 32K window needs the space, so neither side ever has to hold the whole stream.
+// NOTE the Adler-32 checksum at the end isn't checked
+class Inflate
+{
+public:
+    // Sets data and size to the next piece of input; returns false once there's no more
+    typedef std::function<bool(const uint8_t*& data, size_t& size)> Source;
+
+    // Takes the next piece of output; returns false to stop decoding
+    typedef std::function<bool(const uint8_t* data, size_t size)> Sink;
+
+    // Returns false if the stream is malformed, ends early or the sink stops it
+    static bool zlib(const Source& source, const Sink& sink);
+};
+
+#endif //__INFLATE_H__
@@ -0,0 +1,206 @@
+#include "JumpFlood.h"
+#include "SDFMask.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Seed of a texel that hasn't found one yet; every real seed is closer, and the squared distance
+// (0x7FFF - x)^2 + (0x7FFF - y)^2 still fits in an int32 for any texel in a 2^14 texture
+static constexpr uint32_t NONE = 0x7FFF7FFF;
+
+static inline uint32_t pack(int x, int y)
+{
+    return uint32_t(y) << 16 | uint32_t(x);
+}
+
+static inline int32_t distance2(uint32_t seed, int x, int y)
+{
+    const int32_t dx = int32_t(seed & 0xFFFF) - x;
+    const int32_t dy = int32_t(seed >> 16) - y;
+    return dx * dx + dy * dy;
+}
+
+static void floodTexel(const uint8_t* mask, const uint32_t* src, uint32_t* dst, int size, int step, int x, int y)
+{
+    const size_t p = size_t(y) * size + x;
+    const bool inside = mask[p] != 0;
+    uint32_t best = src[p];
+    int32_t bestDist = distance2(best, x, y);
+    for (int qy = y - step; qy <= y + step; qy += step)
+    {
+        if (qy < 0 || qy >= size)
+            continue;
+        for (int qx = x - step; qx <= x + step; qx += step)
+        {
+            if (qx < 0 || qx >= size || (qx == x && qy == y))
+                continue;
+
+            // A neighbor of the other kind is a seed itself; one of the same kind passes on what it found
+            const size_t q = size_t(qy) * size + qx;
+            const uint32_t seed = (mask[q] != 0) == inside ? src[q] : pack(qx, qy);
+            const int32_t dist = distance2(seed, x, y);
+            if (dist < bestDist)
+            {
+                best = seed;
+                bestDist = dist;
+            }
+        }
+    }
+    dst[p] = best;
+}
+
+#if defined(__SSE2__)
+// All ones in the lanes of texels outside the mask
+static inline __m128i loadOutside(const uint8_t* mask)
+{
+    int32_t bytes;
+    memcpy(&bytes, mask, sizeof(bytes));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+    return _mm_cmpeq_epi32(wide, zero);
+}
+
+// Squared distance from each lane's texel; x and y are 16 bit halves, so one madd squares and sums them
+static inline __m128i distance2SSE2(__m128i seed, __m128i texel)
+{
+    const __m128i delta = _mm_sub_epi16(seed, texel);
+    return _mm_madd_epi16(delta, delta);
+}
+
+static inline __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Same as floodTexel for 4 texels whose neighbors k to either side are all inside the row
+static void floodTexelsSSE2(const uint8_t* mask, const uint32_t* src, uint32_t* dst, int size, int step, int x, int y)
+{
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    const size_t p = size_t(y) * size + x;
+    const __m128i texel = _mm_add_epi32(_mm_set1_epi32(int32_t(pack(x, y))), lanes);
+    const __m128i outside = loadOutside(&mask[p]);
+    __m128i best = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[p]));
+    __m128i bestDist = distance2SSE2(best, texel);
+    for (int qy = y - step; qy <= y + step; qy += step)
+    {
+        if (qy < 0 || qy >= size)
+            continue;
+        for (int qx = x - step; qx <= x + step; qx += step)
+        {
+            if (qx == x && qy == y)
+                continue;
+
+            const size_t q = size_t(qy) * size + qx;
+            const __m128i same = _mm_cmpeq_epi32(outside, loadOutside(&mask[q]));
+            const __m128i found = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[q]));
+            const __m128i self = _mm_add_epi32(_mm_set1_epi32(int32_t(pack(qx, qy))), lanes);
+            const __m128i seed = select(same, found, self);
+            const __m128i dist = distance2SSE2(seed, texel);
+
+            // NOTE strictly closer only, so ties go the same way as in floodTexel
+            const __m128i closer = _mm_cmplt_epi32(dist, bestDist);
+            best = select(closer, seed, best);
+            bestDist = select(closer, dist, bestDist);
+        }
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[p]), best);
+}
+#endif
+
+static void floodRow(const uint8_t* mask, const uint32_t* src, uint32_t* dst, int size, int step, int y)
+{
+    int x = 0;
+    while (x < size)
+    {
+#if defined(__SSE2__)
+        if (x >= step && x + 4 <= size - step)
+        {
+            floodTexelsSSE2(mask, src, dst, size, step, x, y);
+            x += 4;
+            continue;
+        }
+#endif
+        floodTexel(mask, src, dst, size, step, x, y);
+        ++x;
+    }
+}
+
+int JumpFlood::passes(int size, bool correction)
+{
+    int passes = correction ? 1 : 0;
+    for (int step = size / 2; step >= 1; step /= 2)
+        ++passes;
+    return passes;
+}
+
+template <typename Emit>
+static bool flood(const uint8_t* mask, int size, ThreadPool& pool, ScratchArena& scratch, bool correction, const Emit& emit)
+{
+    const size_t gridBytes = ScratchArena::align(size_t(size) * size * sizeof(uint32_t));
+    uint8_t* memory = scratch.get<uint8_t>(2 * gridBytes);
+    if (!memory)
+        return false;
+
+    uint32_t* src = reinterpret_cast<uint32_t*>(memory);
+    uint32_t* dst = reinterpret_cast<uint32_t*>(memory + gridBytes);
+    std::fill(src, src + size_t(size) * size, NONE);
+
+    // Each pass reads the whole previous grid, so the bands of a pass only need to finish before the next
+    const int bands = std::min(size, pool.size() * 4);
+    const int passes = JumpFlood::passes(size, correction);
+    int step = correction ? 1 : size / 2;
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        pool.parallelFor(bands, [&](int band)
+        {
+            const int y0 = int(int64_t(size) * band / bands);
+            const int y1 = int(int64_t(size) * (band + 1) / bands);
+            for (int y = y0; y < y1; ++y)
+                floodRow(mask, src, dst, size, step, y);
+        });
+        std::swap(src, dst);
+        step = pass == 0 && correction ? size / 2 : step / 2;
+    }
+
+    // Same convention as DistanceTransform: centers are a whole texel from their nearest opposite neighbor
+    const float limit = 2.f * size;
+    pool.parallelFor(bands, [&](int band)
+    {
+        const int y0 = int(int64_t(size) * band / bands);
+        const int y1 = int(int64_t(size) * (band + 1) / bands);
+        for (int y = y0; y < y1; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+            {
+                const size_t p = size_t(y) * size + x;
+                const uint32_t seed = src[p];
+                const float dist = (seed == NONE ? limit : std::min(sqrtf(float(distance2(seed, x, y))), limit)) - 0.5f;
+                emit(p, mask[p] != 0 ? dist : -dist);
+            }
+        }
+    });
+
+    return true;
+}
+
+bool JumpFlood::generate(const uint8_t* mask, int size, float radius, int8_t* dst, ThreadPool& pool, ScratchArena& scratch,
+    bool correction)
+{
+    return flood(mask, size, pool, scratch, correction, [&](size_t p, float distance)
+    {
+        dst[p] = SDFMask::encode(distance, radius);
+    });
+}
+
+bool JumpFlood::distances(const uint8_t* mask, int size, float* dst, ThreadPool& pool, ScratchArena& scratch, bool correction)
+{
+    return flood(mask, size, pool, scratch, correction, [&](size_t p, float distance)
+    {
+        dst[p] = distance;
+    });
+}
@@ -0,0 +1,32 @@
+#ifndef __JUMPFLOOD_H__
+#define __JUMPFLOOD_H__
+
+#include "ThreadPool.h"
+#include "ScratchArena.h"
+
+#include <cstdint>
+
+// Approximate Euclidean distance transform of a binary mask by jump flooding
+// Every texel keeps the nearest texel of the other kind it has seen so far, packed as (y << 16) | x, and
+// each pass offers it what its neighbors k texels away have seen, for k = size/2 down to 1. The cost is
+// a fixed log2(size) passes of 9 lookups per texel whatever the shape, with rows split into bands across
+// the pool's threads.
+// With the 1+JFA correction an extra pass with k = 1 goes first, which fixes most of the texels that
+// plain JFA gets wrong.
+// NOTE needs 8 bytes of scratch per texel, so a 2^14 field needs 2GB
+class JumpFlood
+{
+public:
+    // Signed distance field of a size x size mask, encoded like the kernels' output
+    static bool generate(const uint8_t* mask, int size, float radius, int8_t* dst, ThreadPool& pool, ScratchArena& scratch,
+        bool correction = true);
+
+    // The same field as plain signed distances in texels, positive inside
+    static bool distances(const uint8_t* mask, int size, float* dst, ThreadPool& pool, ScratchArena& scratch,
+        bool correction = true);
+
+    // Number of flood passes for a size x size mask
+    static int passes(int size, bool correction);
+};
+
+#endif //__JUMPFLOOD_H__
@@ -0,0 +1,454 @@
+#include "MaskImage.h"
+#include "Inflate.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+// Two packed rows and a gray one are allocated from the header alone, before any data is read, so a corrupt
+// one mustn't be able to ask for gigabytes; this is 2M pixels of 16 bit RGBA, and caps the width for 1 bit images
+static const uint64_t MAX_PNG_ROW_BYTES = 16 << 20;
+
+static uint32_t readBE32(const uint8_t* data)
+{
+    return uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 | uint32_t(data[2]) << 8 | data[3];
+}
+
+// Rec. 601 luma in 8 bit fixed point
+static uint8_t luma(uint32_t r, uint32_t g, uint32_t b)
+{
+    return uint8_t((r * 77 + g * 150 + b * 29 + 128) >> 8);
+}
+
+static uint8_t premultiply(uint32_t gray, uint32_t alpha)
+{
+    return uint8_t((gray * alpha + 127) / 255);
+}
+
+bool MaskImage::open(const char* path)
+{
+    close();
+
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // NOTE the mapping outlives the descriptor
+    void* data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    // Rows are read front to back exactly once
+    madvise(data, size_t(info.st_size), MADV_SEQUENTIAL);
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = size_t(info.st_size);
+
+    if (m_size >= 2 && m_data[0] == 'P' && m_data[1] == '5' && parsePGM())
+        m_format = FORMAT_PGM;
+    else if (m_size >= sizeof(PNG_SIGNATURE) && memcmp(m_data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0 && parsePNG())
+        m_format = FORMAT_PNG;
+    else
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MaskImage::close()
+{
+    if (m_data)
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+    m_format = FORMAT_NONE;
+    m_width = 0;
+    m_height = 0;
+}
+
+bool MaskImage::readRows(const RowCallback& callback)
+{
+    if (m_format == FORMAT_PGM)
+        return readPGM(callback);
+    if (m_format == FORMAT_PNG)
+        return readPNG(callback);
+    return false;
+}
+
+bool MaskImage::parsePGM()
+{
+    // Width, height and max value, separated by whitespace and comments, then a single whitespace byte
+    size_t pos = 2;
+    int values[3];
+    for (int& value : values)
+    {
+        while (pos < m_size && (isspace(m_data[pos]) || m_data[pos] == '#'))
+        {
+            if (m_data[pos] == '#')
+            {
+                while (pos < m_size && m_data[pos] != '\n')
+                    ++pos;
+            }
+            else
+                ++pos;
+        }
+
+        if (pos >= m_size || !isdigit(m_data[pos]))
+            return false;
+        int64_t parsed = 0;
+        while (pos < m_size && isdigit(m_data[pos]) && parsed <= 0xFFFFFF)
+            parsed = parsed * 10 + (m_data[pos++] - '0');
+        value = int(parsed);
+    }
+    if (pos >= m_size || !isspace(m_data[pos]))
+        return false;
+
+    m_width = values[0];
+    m_height = values[1];
+    m_maxValue = values[2];
+    m_pixelOffset = pos + 1;
+
+    const size_t bytes = size_t(m_width) * m_height * (m_maxValue > 255 ? 2 : 1);
+    return m_width > 0 && m_height > 0 && m_maxValue > 0 && m_maxValue <= 65535 && m_size - m_pixelOffset >= bytes;
+}
+
+bool MaskImage::readPGM(const RowCallback& callback)
+{
+    const uint8_t* pixels = m_data + m_pixelOffset;
+    const bool wide = m_maxValue > 255;
+
+    // The common 8 bit case hands out rows of the mapping itself
+    if (!wide && m_maxValue == 255)
+    {
+        for (int y = 0; y < m_height; ++y)
+        {
+            if (!callback(y, pixels + size_t(y) * m_width))
+                return false;
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> row(m_width);
+    for (int y = 0; y < m_height; ++y)
+    {
+        const uint8_t* src = pixels + size_t(y) * m_width * (wide ? 2 : 1);
+        for (int x = 0; x < m_width; ++x)
+        {
+            const uint32_t value = wide ? uint32_t(src[2*x]) << 8 | src[2*x+1] : src[x];
+            row[x] = uint8_t((std::min<uint32_t>(value, m_maxValue) * 255 + m_maxValue / 2) / m_maxValue);
+        }
+        if (!callback(y, row.data()))
+            return false;
+    }
+    return true;
+}
+
+bool MaskImage::parsePNG()
+{
+    // Chunks up to the first IDAT: IHDR, and the palette and its transparency if there are any
+    uint8_t alpha[256];
+    memset(alpha, 255, sizeof(alpha));
+    uint8_t rgb[256 * 3] = {};
+    bool header = false;
+
+    size_t pos = sizeof(PNG_SIGNATURE);
+    while (pos + 12 <= m_size)
+    {
+        const uint32_t length = readBE32(m_data + pos);
+        const uint8_t* type = m_data + pos + 4;
+        const uint8_t* data = m_data + pos + 8;
+        if (length > m_size - pos - 12)
+            return false;
+
+        if (memcmp(type, "IHDR", 4) == 0 && length >= 13)
+        {
+            // NOTE the spec caps both dimensions at 2^31 - 1, so anything bigger is corrupt rather than huge
+            const uint32_t width = readBE32(data);
+            const uint32_t height = readBE32(data + 4);
+            m_bitDepth = data[8];
+            m_colorType = data[9];
+            const bool interlaced = data[12] != 0;
+            static const int CHANNELS[7] = {1, 0, 3, 1, 2, 0, 4};
+            m_channels = m_colorType <= 6 ? CHANNELS[m_colorType] : 0;
+            if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF || m_channels == 0 || interlaced ||
+                data[10] != 0 || data[11] != 0)
+                return false;
+            const bool validDepth = m_colorType == 0 ? (m_bitDepth == 1 || m_bitDepth == 2 || m_bitDepth == 4 || m_bitDepth == 8 || m_bitDepth == 16)
+                : m_colorType == 3 ? (m_bitDepth == 1 || m_bitDepth == 2 || m_bitDepth == 4 || m_bitDepth == 8)
+                : (m_bitDepth == 8 || m_bitDepth == 16);
+            if (!validDepth || width > MAX_PNG_ROW_BYTES || (uint64_t(width) * m_channels * m_bitDepth + 7) / 8 > MAX_PNG_ROW_BYTES)
+                return false;
+            m_width = int(width);
+            m_height = int(height);
+            header = true;
+        }
+        else if (memcmp(type, "PLTE", 4) == 0)
+            memcpy(rgb, data, std::min<size_t>(length, sizeof(rgb)));
+        else if (memcmp(type, "tRNS", 4) == 0 && m_colorType == 3)
+            memcpy(alpha, data, std::min<size_t>(length, sizeof(alpha)));
+        else if (memcmp(type, "IDAT", 4) == 0)
+        {
+            m_firstChunk = pos;
+            break;
+        }
+
+        pos += 12 + length;
+    }
+
+    for (int i = 0; i < 256; ++i)
+        m_palette[i] = premultiply(luma(rgb[3*i], rgb[3*i+1], rgb[3*i+2]), alpha[i]);
+
+    return header && m_firstChunk != 0;
+}
+
+// Undoes one row's PNG filter in place; prev is the previous unfiltered row, all zeros before the first
+static bool unfilter(int filter, uint8_t* row, const uint8_t* prev, size_t stride, int bpp)
+{
+    switch (filter)
+    {
+    case 0:
+        return true;
+    case 1:
+        for (size_t i = bpp; i < stride; ++i)
+            row[i] += row[i - bpp];
+        return true;
+    case 2:
+        for (size_t i = 0; i < stride; ++i)
+            row[i] += prev[i];
+        return true;
+    case 3:
+        for (size_t i = 0; i < stride; ++i)
+            row[i] += uint8_t(((i >= size_t(bpp) ? row[i - bpp] : 0) + prev[i]) >> 1);
+        return true;
+    case 4:
+        for (size_t i = 0; i < stride; ++i)
+        {
+            const int a = i >= size_t(bpp) ? row[i - bpp] : 0;
+            const int b = prev[i];
+            const int c = i >= size_t(bpp) ? prev[i - bpp] : 0;
+            const int p = a + b - c;
+            const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+            row[i] += uint8_t(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool MaskImage::readPNG(const RowCallback& callback)
+{
+    const size_t stride = (size_t(m_width) * m_channels * m_bitDepth + 7) / 8;
+    const int bpp = std::max(1, m_channels * m_bitDepth / 8);
+
+    // Only the row being filled and the one before it are kept; the one before the first is all zeros
+    std::vector<uint8_t> rows(2 * (stride + 1));
+    uint8_t* current = rows.data();
+    uint8_t* previous = rows.data() + stride + 1;
+    std::vector<uint8_t> gray(m_width);
+    size_t filled = 0;
+    int y = 0;
+    bool stopped = false;
+
+    // Consecutive IDAT chunks make up one zlib stream
+    size_t pos = m_firstChunk;
+    auto source = [&](const uint8_t*& data, size_t& size)
+    {
+        while (pos + 12 <= m_size)
+        {
+            const uint32_t length = readBE32(m_data + pos);
+            if (memcmp(m_data + pos + 4, "IDAT", 4) != 0 || length > m_size - pos - 12)
+                return false;
+            data = m_data + pos + 8;
+            size = length;
+            pos += 12 + length;
+            if (length > 0)
+                return true;
+        }
+        return false;
+    };
+
+    auto convertRow = [&]()
+    {
+        const uint8_t* row = current + 1;
+        const int shift = m_bitDepth == 16 ? 1 : 0;
+        for (int x = 0; x < m_width; ++x)
+        {
+            if (m_bitDepth < 8)
+            {
+                const int bit = x * m_bitDepth;
+                const uint32_t value = (row[bit >> 3] >> (8 - m_bitDepth - (bit & 7))) & ((1 << m_bitDepth) - 1);
+                gray[x] = m_colorType == 3 ? m_palette[value] : uint8_t(value * 255 / ((1 << m_bitDepth) - 1));
+                continue;
+            }
+
+            // 16 bit samples are big endian, so their first byte is the high one
+            const uint8_t* p = row + (size_t(x) * m_channels << shift);
+            auto sample = [&](int channel) {return uint32_t(p[channel << shift]);};
+            switch (m_colorType)
+            {
+            case 0: gray[x] = uint8_t(sample(0)); break;
+            case 2: gray[x] = luma(sample(0), sample(1), sample(2)); break;
+            case 3: gray[x] = m_palette[p[0]]; break;
+            case 4: gray[x] = premultiply(sample(0), sample(1)); break;
+            case 6: gray[x] = premultiply(luma(sample(0), sample(1), sample(2)), sample(3)); break;
+            }
+        }
+    };
+
+    auto sink = [&](const uint8_t* data, size_t size)
+    {
+        while (size > 0 && y < m_height)
+        {
+            const size_t count = std::min(size, stride + 1 - filled);
+            memcpy(current + filled, data, count);
+            filled += count;
+            data += count;
+            size -= count;
+            if (filled < stride + 1)
+                break;
+
+            if (!unfilter(current[0], current + 1, previous + 1, stride, bpp))
+                return false;
+            convertRow();
+            if (!callback(y, gray.data()))
+            {
+                stopped = true;
+                return false;
+            }
+            std::swap(current, previous);
+            filled = 0;
+            ++y;
+        }
+        return true;
+    };
+
+    return Inflate::zlib(source, sink) && !stopped && y == m_height;
+}
+
+namespace
+{
+    // Box filters rows into the mask as they arrive, keeping just the one mask row still being summed
+    class Resampler
+    {
+        int m_size;
+        int m_width;
+        float m_scale; // mask texels per image pixel
+        float m_x0, m_y0; // where the image starts in the mask
+        bool m_binary;
+        bool m_invert;
+        uint8_t* m_dst;
+        std::vector<float> m_row;
+        std::vector<float> m_sum;
+        int m_sumRow;
+        int m_written;
+
+    public:
+        Resampler(int width, int height, int size, bool binary, bool invert, uint8_t* dst):
+            m_size(size), m_width(width), m_scale(float(size) / std::max(width, height)),
+            m_x0(0.5f * (size - width * m_scale)), m_y0(0.5f * (size - height * m_scale)),
+            m_binary(binary), m_invert(invert), m_dst(dst), m_row(size), m_sum(size), m_sumRow(-1), m_written(0) {}
+
+        void addRow(int y, const uint8_t* gray)
+        {
+            // Spread each pixel over the mask texels it overlaps, weighted by the overlap
+            std::fill(m_row.begin(), m_row.end(), 0.f);
+            for (int x = 0; x < m_width; ++x)
+            {
+                const float value = m_invert ? 255 - gray[x] : gray[x];
+                if (value == 0.f)
+                    continue;
+                const float a = m_x0 + x * m_scale;
+                const float b = a + m_scale;
+                const int last = std::min(int(ceilf(b)), m_size);
+                for (int tx = std::max(int(a), 0); tx < last; ++tx)
+                    m_row[tx] += value * (std::min(b, tx + 1.f) - std::max(a, float(tx)));
+            }
+
+            const float a = m_y0 + y * m_scale;
+            const float b = a + m_scale;
+            const int last = std::min(int(ceilf(b)), m_size);
+            for (int ty = std::max(int(a), 0); ty < last; ++ty)
+            {
+                // Moving on to a new mask row means the one being summed has had all its pixels
+                if (ty != m_sumRow)
+                {
+                    if (m_sumRow >= 0)
+                        writeRow(m_sumRow);
+                    std::fill(m_sum.begin(), m_sum.end(), 0.f);
+                    m_sumRow = ty;
+                }
+
+                const float weight = std::min(b, ty + 1.f) - std::max(a, float(ty));
+                for (int tx = 0; tx < m_size; ++tx)
+                    m_sum[tx] += weight * m_row[tx];
+
+                if (b >= ty + 1.f)
+                {
+                    writeRow(ty);
+                    m_sumRow = -1;
+                }
+            }
+        }
+
+        void finish()
+        {
+            if (m_sumRow >= 0)
+                writeRow(m_sumRow);
+            m_sumRow = -1;
+            if (m_written < m_size)
+                memset(m_dst + size_t(m_written) * m_size, 0, size_t(m_size - m_written) * m_size);
+            m_written = m_size;
+        }
+
+    private:
+        void writeRow(int ty)
+        {
+            // Rows above the image are background
+            if (ty > m_written)
+                memset(m_dst + size_t(m_written) * m_size, 0, size_t(ty - m_written) * m_size);
+
+            uint8_t* row = m_dst + size_t(ty) * m_size;
+            for (int tx = 0; tx < m_size; ++tx)
+            {
+                const float value = m_sum[tx];
+                row[tx] = m_binary ? value >= 127.5f : uint8_t(std::min(value + 0.5f, 255.f));
+            }
+            m_written = ty + 1;
+        }
+    };
+}
+
+bool MaskImage::load(const char* path, int size, bool binary, bool invert, uint8_t* dst)
+{
+    MaskImage image;
+    if (!image.open(path))
+        return false;
+
+    Resampler resampler(image.width(), image.height(), size, binary, invert, dst);
+    const bool read = image.readRows([&](int y, const uint8_t* row)
+    {
+        resampler.addRow(y, row);
+        return true;
+    });
+    resampler.finish();
+    return read;
+}
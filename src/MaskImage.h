@@ -0,0 +1,69 @@
+#ifndef __MASKIMAGE_H__
+#define __MASKIMAGE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Grayscale images decoded one row at a time, so a large scanned mask never needs a decoded copy in memory
+// Binary PGM (P5) rows are read straight out of a memory map; PNG is mapped too and inflated as it's read.
+// Color is converted to luma and alpha multiplied in, so transparent pixels are dark.
+// NOTE interlaced PNGs aren't supported, nor PNGs over 16M pixels wide or with rows over 16 MB decoded
+class MaskImage
+{
+public:
+    // Gets each row of 8 bit gray values in order; returns false to stop reading
+    typedef std::function<bool(int y, const uint8_t* row)> RowCallback;
+
+private:
+    enum Format
+    {
+        FORMAT_NONE,
+        FORMAT_PGM,
+        FORMAT_PNG,
+    };
+
+    const uint8_t* m_data;
+    size_t m_size;
+    Format m_format;
+    int m_width, m_height;
+
+    // PGM
+    size_t m_pixelOffset;
+    int m_maxValue;
+
+    // PNG
+    size_t m_firstChunk; // first IDAT
+    int m_bitDepth, m_colorType, m_channels;
+    uint8_t m_palette[256]; // already in gray, with alpha multiplied in
+
+public:
+    MaskImage(): m_data(nullptr), m_size(0), m_format(FORMAT_NONE), m_width(0), m_height(0), m_pixelOffset(0),
+        m_maxValue(0), m_firstChunk(0), m_bitDepth(0), m_colorType(0), m_channels(0), m_palette{} {}
+    ~MaskImage() {close();}
+
+    MaskImage(const MaskImage&) = delete;
+    MaskImage& operator=(const MaskImage&) = delete;
+
+    // Maps the file and reads its header
+    bool open(const char* path);
+    void close();
+
+    int width() const {return m_width;}
+    int height() const {return m_height;}
+
+    bool readRows(const RowCallback& callback);
+
+    // Reads an image into a size x size mask, scaled to fit and centered, with each texel the average of the
+    // pixels it covers. Bright pixels are inside unless inverted. A binary mask is 1 where at least half the
+    // texel is inside, otherwise texels are coverage from 0 to 255.
+    static bool load(const char* path, int size, bool binary, bool invert, uint8_t* dst);
+
+private:
+    bool parsePGM();
+    bool parsePNG();
+    bool readPGM(const RowCallback& callback);
+    bool readPNG(const RowCallback& callback);
+};
+
+#endif //__MASKIMAGE_H__
@@ -0,0 +1,105 @@
+#include "SDFFrameCache.h"
+
+#include <algorithm>
+
+bool SDFFrameCache::reserve(int texSize, size_t budgetBytes, GLint filter)
+{
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+    const size_t layerBytes = size_t(texSize) * texSize;
+    const int layers = int(std::min(budgetBytes / layerBytes, size_t(maxLayers)));
+    if (layers < 1)
+    {
+        release();
+        return false;
+    }
+
+    if (m_texture && texSize == m_texSize && layers == int(m_layers.size()))
+        return true;
+
+    release();
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8_SNORM, texSize, texSize, layers, 0, GL_RED, GL_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    m_texSize = texSize;
+    m_layers.assign(layers, Layer());
+    return true;
+}
+
+void SDFFrameCache::release()
+{
+    if (m_texture)
+    {
+        glDeleteTextures(1, &m_texture);
+        m_texture = 0;
+    }
+
+    m_texSize = 0;
+    m_layers.clear();
+}
+
+void SDFFrameCache::clear()
+{
+    for (auto& layer : m_layers)
+        layer.lastUse = 0;
+}
+
+int SDFFrameCache::lookup(const Key& key, bool& hit)
+{
+    // NOTE a linear scan is plenty for a few hundred layers
+    int victim = 0;
+    for (int i = 0; i < int(m_layers.size()); ++i)
+    {
+        Layer& layer = m_layers[i];
+        if (layer.lastUse != 0 && layer.key == key)
+        {
+            layer.lastUse = ++m_clock;
+            ++m_hits;
+            hit = true;
+            return i;
+        }
+
+        if (layer.lastUse < m_layers[victim].lastUse)
+            victim = i;
+    }
+
+    m_layers[victim].lastUse = 0;
+    ++m_misses;
+    hit = false;
+    return victim;
+}
+
+void SDFFrameCache::store(int layer, const Key& key)
+{
+    m_layers[layer].key = key;
+    m_layers[layer].lastUse = ++m_clock;
+}
+
+bool SDFFrameCache::contains(const Key& key) const
+{
+    for (const Layer& layer : m_layers)
+    {
+        if (layer.lastUse != 0 && layer.key == key)
+            return true;
+    }
+    return false;
+}
+
+void SDFFrameCache::setFilter(GLint filter)
+{
+    if (!m_texture)
+        return;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
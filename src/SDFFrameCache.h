@@ -0,0 +1,69 @@
+#ifndef __SDFFRAMECACHE_H__
+#define __SDFFRAMECACHE_H__
+
+#include "GlfwInstance.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Baked frames kept as layers of one texture array and evicted least recently used first
+class SDFFrameCache
+{
+public:
+    struct Key
+    {
+        bool circle;
+        int32_t generator;
+        int32_t texPow;
+        int32_t radiusStep; // radius divided by the quantization step
+
+        bool operator==(const Key& other) const
+        {
+            return circle == other.circle && generator == other.generator && texPow == other.texPow && radiusStep == other.radiusStep;
+        }
+    };
+
+private:
+    struct Layer
+    {
+        Key key;
+        uint64_t lastUse; // 0 while the layer is empty
+    };
+
+    GLuint m_texture;
+    int m_texSize;
+    std::vector<Layer> m_layers;
+    uint64_t m_clock;
+    uint32_t m_hits, m_misses;
+
+public:
+    SDFFrameCache(): m_texture(0), m_texSize(0), m_clock(0), m_hits(0), m_misses(0) {}
+    ~SDFFrameCache() {release();}
+
+    SDFFrameCache(const SDFFrameCache&) = delete;
+    SDFFrameCache& operator=(const SDFFrameCache&) = delete;
+
+    // Reallocates the array if the layer size or count changes, which drops every frame
+    // Returns false if not even one layer fits in the budget
+    bool reserve(int texSize, size_t budgetBytes, GLint filter);
+    void release();
+    void clear();
+
+    // On a miss the least recently used layer is emptied and handed out; the caller bakes into it
+    // and only then stores the key, so a bake that fails never leaves a layer claiming a frame
+    int lookup(const Key& key, bool& hit);
+    void store(int layer, const Key& key);
+
+    // Whether a frame is cached, without counting a hit or touching its age
+    bool contains(const Key& key) const;
+
+    void setFilter(GLint filter);
+
+    GLuint texture() const {return m_texture;}
+    int layers() const {return int(m_layers.size());}
+    uint32_t hits() const {return m_hits;}
+    uint32_t misses() const {return m_misses;}
+};
+
+#endif //__SDFFRAMECACHE_H__
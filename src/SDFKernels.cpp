@@ -0,0 +1,296 @@
+#include "SDFKernels.h"
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SDF_X86 1
+#include <immintrin.h>
+#endif
+
+// NOTE the narrowing wraps through int32 on purpose; overflowing the distance is what makes
+// the interesting patterns, and the SIMD paths must produce the exact same bytes
+static inline int8_t narrow(float value)
+{
+    return int8_t(int32_t(value));
+}
+
+static void circleRowScalar(int8_t* dst, int count, float fx, float fy, float radius)
+{
+    const float fy2 = fy * fy;
+    for (int x = 0; x < count; ++x)
+    {
+        const float px = fx + x;
+        dst[x] = narrow((radius - sqrtf(px*px + fy2)) * 127 / radius);
+    }
+}
+
+// Exact box distance without branches: length(max(q,0)) + min(max(qx,qy),0) with q = |p| - r
+static void boxRowScalar(int8_t* dst, int count, float fx, float fy, float radius)
+{
+    const float qy = fabsf(fy) - radius;
+    const float oy = std::max(qy, 0.f);
+    for (int x = 0; x < count; ++x)
+    {
+        const float qx = fabsf(fx + x) - radius;
+        const float ox = std::max(qx, 0.f);
+        const float dist = sqrtf(ox*ox + oy*oy) + std::min(std::max(qx, qy), 0.f);
+        dst[x] = narrow(-dist * 127 / radius);
+    }
+}
+
+#ifdef SDF_X86
+
+__attribute__((target("sse2")))
+static inline void storeSSE2(int8_t* dst, __m128 value)
+{
+    // Keep the low byte of each int32 sign-extended so the saturating packs are exact
+    __m128i i32 = _mm_cvttps_epi32(value);
+    i32 = _mm_srai_epi32(_mm_slli_epi32(i32, 24), 24);
+    i32 = _mm_packs_epi32(i32, i32);
+    i32 = _mm_packs_epi16(i32, i32);
+    const int32_t packed = _mm_cvtsi128_si32(i32);
+    memcpy(dst, &packed, 4);
+}
+
+__attribute__((target("sse2")))
+static void circleRowSSE2(int8_t* dst, int count, float fx, float fy, float radius)
+{
+    const __m128 fy2 = _mm_set1_ps(fy * fy);
+    const __m128 r = _mm_set1_ps(radius);
+    const __m128 scale = _mm_set1_ps(127.f);
+    __m128 px = _mm_add_ps(_mm_set1_ps(fx), _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+    const __m128 step = _mm_set1_ps(4.f);
+
+    int x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+        const __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(px, px), fy2));
+        storeSSE2(dst + x, _mm_div_ps(_mm_mul_ps(_mm_sub_ps(r, dist), scale), r));
+        px = _mm_add_ps(px, step);
+    }
+
+    circleRowScalar(dst + x, count - x, fx + x, fy, radius);
+}
+
+__attribute__((target("sse2")))
+static void boxRowSSE2(int8_t* dst, int count, float fx, float fy, float radius)
+{
+    const __m128 sign = _mm_set1_ps(-0.f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 r = _mm_set1_ps(radius);
+    const __m128 scale = _mm_set1_ps(127.f);
+    const __m128 qy = _mm_set1_ps(fabsf(fy) - radius);
+    const __m128 oy = _mm_max_ps(qy, zero);
+    const __m128 oy2 = _mm_mul_ps(oy, oy);
+    __m128 px = _mm_add_ps(_mm_set1_ps(fx), _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+    const __m128 step = _mm_set1_ps(4.f);
+
+    int x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+        const __m128 qx = _mm_sub_ps(_mm_andnot_ps(sign, px), r);
+        const __m128 ox = _mm_max_ps(qx, zero);
+        const __m128 outside = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ox, ox), oy2));
+        const __m128 inside = _mm_min_ps(_mm_max_ps(qx, qy), zero);
+        const __m128 dist = _mm_xor_ps(_mm_add_ps(outside, inside), sign);
+        storeSSE2(dst + x, _mm_div_ps(_mm_mul_ps(dist, scale), r));
+        px = _mm_add_ps(px, step);
+    }
+
+    boxRowScalar(dst + x, count - x, fx + x, fy, radius);
+}
+
+__attribute__((target("avx2")))
+static inline void storeAVX2(int8_t* dst, __m256 value)
+{
+    __m256i i32 = _mm256_cvttps_epi32(value);
+    i32 = _mm256_srai_epi32(_mm256_slli_epi32(i32, 24), 24);
+    __m128i i16 = _mm_packs_epi32(_mm256_castsi256_si128(i32), _mm256_extracti128_si256(i32, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packs_epi16(i16, i16));
+}
+
+__attribute__((target("avx2")))
+static void circleRowAVX2(int8_t* dst, int count, float fx, float fy, float radius)
+{
+    const __m256 fy2 = _mm256_set1_ps(fy * fy);
+    const __m256 r = _mm256_set1_ps(radius);
+    const __m256 scale = _mm256_set1_ps(127.f);
+    __m256 px = _mm256_add_ps(_mm256_set1_ps(fx), _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f));
+    const __m256 step = _mm256_set1_ps(8.f);
+
+    int x = 0;
+    for (; x + 8 <= count; x += 8)
+    {
+        const __m256 dist = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(px, px), fy2));
+        storeAVX2(dst + x, _mm256_div_ps(_mm256_mul_ps(_mm256_sub_ps(r, dist), scale), r));
+        px = _mm256_add_ps(px, step);
+    }
+
+    circleRowSSE2(dst + x, count - x, fx + x, fy, radius);
+}
+
+__attribute__((target("avx2")))
+static void boxRowAVX2(int8_t* dst, int count, float fx, float fy, float radius)
+{
+    const __m256 sign = _mm256_set1_ps(-0.f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 r = _mm256_set1_ps(radius);
+    const __m256 scale = _mm256_set1_ps(127.f);
+    const __m256 qy = _mm256_set1_ps(fabsf(fy) - radius);
+    const __m256 oy = _mm256_max_ps(qy, zero);
+    const __m256 oy2 = _mm256_mul_ps(oy, oy);
+    __m256 px = _mm256_add_ps(_mm256_set1_ps(fx), _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f));
+    const __m256 step = _mm256_set1_ps(8.f);
+
+    int x = 0;
+    for (; x + 8 <= count; x += 8)
+    {
+        const __m256 qx = _mm256_sub_ps(_mm256_andnot_ps(sign, px), r);
+        const __m256 ox = _mm256_max_ps(qx, zero);
+        const __m256 outside = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(ox, ox), oy2));
+        const __m256 inside = _mm256_min_ps(_mm256_max_ps(qx, qy), zero);
+        const __m256 dist = _mm256_xor_ps(_mm256_add_ps(outside, inside), sign);
+        storeAVX2(dst + x, _mm256_div_ps(_mm256_mul_ps(dist, scale), r));
+        px = _mm256_add_ps(px, step);
+    }
+
+    boxRowSSE2(dst + x, count - x, fx + x, fy, radius);
+}
+
+// NOTE GCC 12 warns about the _mm512_undefined_* sources inside its own headers, so only these kernels hide it
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+__attribute__((target("avx512f")))
+static inline void storeAVX512(int8_t* dst, __m512 value)
+{
+    // vpmovdb truncates to the low byte, same as the scalar wrap
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm512_cvtepi32_epi8(_mm512_cvttps_epi32(value)));
+}
+
+__attribute__((target("avx512f")))
+static void circleRowAVX512(int8_t* dst, int count, float fx, float fy, float radius)
+{
+    const __m512 fy2 = _mm512_set1_ps(fy * fy);
+    const __m512 r = _mm512_set1_ps(radius);
+    const __m512 scale = _mm512_set1_ps(127.f);
+    __m512 px = _mm512_add_ps(_mm512_set1_ps(fx), _mm512_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f,
+        8.f, 9.f, 10.f, 11.f, 12.f, 13.f, 14.f, 15.f));
+    const __m512 step = _mm512_set1_ps(16.f);
+
+    int x = 0;
+    for (; x + 16 <= count; x += 16)
+    {
+        const __m512 dist = _mm512_sqrt_ps(_mm512_add_ps(_mm512_mul_ps(px, px), fy2));
+        storeAVX512(dst + x, _mm512_div_ps(_mm512_mul_ps(_mm512_sub_ps(r, dist), scale), r));
+        px = _mm512_add_ps(px, step);
+    }
+
+    circleRowAVX2(dst + x, count - x, fx + x, fy, radius);
+}
+
+__attribute__((target("avx512f")))
+static void boxRowAVX512(int8_t* dst, int count, float fx, float fy, float radius)
+{
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 r = _mm512_set1_ps(radius);
+    const __m512 scale = _mm512_set1_ps(-127.f);
+    const __m512 qy = _mm512_set1_ps(fabsf(fy) - radius);
+    const __m512 oy = _mm512_max_ps(qy, zero);
+    const __m512 oy2 = _mm512_mul_ps(oy, oy);
+    __m512 px = _mm512_add_ps(_mm512_set1_ps(fx), _mm512_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f,
+        8.f, 9.f, 10.f, 11.f, 12.f, 13.f, 14.f, 15.f));
+    const __m512 step = _mm512_set1_ps(16.f);
+
+    int x = 0;
+    for (; x + 16 <= count; x += 16)
+    {
+        const __m512 qx = _mm512_sub_ps(_mm512_abs_ps(px), r);
+        const __m512 ox = _mm512_max_ps(qx, zero);
+        const __m512 outside = _mm512_sqrt_ps(_mm512_add_ps(_mm512_mul_ps(ox, ox), oy2));
+        const __m512 inside = _mm512_min_ps(_mm512_max_ps(qx, qy), zero);
+        // NOTE -dist * 127 == dist * -127 exactly, and AVX-512F has no float xor
+        storeAVX512(dst + x, _mm512_div_ps(_mm512_mul_ps(_mm512_add_ps(outside, inside), scale), r));
+        px = _mm512_add_ps(px, step);
+    }
+
+    boxRowAVX2(dst + x, count - x, fx + x, fy, radius);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif //SDF_X86
+
+static const SDFKernels s_kernels[] =
+{
+    {SimdLevel::Scalar, circleRowScalar, boxRowScalar},
+#ifdef SDF_X86
+    {SimdLevel::SSE2, circleRowSSE2, boxRowSSE2},
+    {SimdLevel::AVX2, circleRowAVX2, boxRowAVX2},
+    {SimdLevel::AVX512, circleRowAVX512, boxRowAVX512},
+#endif
+};
+
+SimdLevel SDFKernels::detect()
+{
+#ifdef SDF_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+const SDFKernels& SDFKernels::get()
+{
+    static const SDFKernels& kernels = get(detect());
+    return kernels;
+}
+
+const SDFKernels& SDFKernels::get(SimdLevel level)
+{
+    static const SimdLevel supported = detect();
+    if (level > supported)
+        level = supported;
+    return s_kernels[int(level)];
+}
+
+int SDFKernels::tileRows(int texSize)
+{
+    // NOTE whole rows keep each upload contiguous and give the row kernels long runs
+    return std::max(std::min(TILE_TEXELS / texSize, texSize), 1);
+}
+
+void SDFKernels::bakeRows(SDFRowKernel rowKernel, int texSize, float radius, int8_t* texData, int y0, int rows)
+{
+    const float fx = -(texSize / 2) + 0.5f;
+    for (int y = 0; y < rows; ++y)
+    {
+        const float fy = y0 + y - (texSize / 2) + 0.5f;
+        rowKernel(&texData[y*texSize], texSize, fx, fy, radius);
+    }
+}
+
+const char* SDFKernels::name(SimdLevel level)
+{
+    switch (level)
+    {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::SSE2: return "sse2";
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::AVX512: return "avx512";
+    }
+    return "unknown";
+}
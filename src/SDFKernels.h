@@ -0,0 +1,42 @@
+#ifndef __SDFKERNELS_H__
+#define __SDFKERNELS_H__
+
+#include <cstdint>
+
+// NOTE kept free of GL so the kernels can be built and tested on their own
+
+enum class SimdLevel : int32_t
+{
+    Scalar,
+    SSE2,   // 4 texels per iteration
+    AVX2,   // 8 texels per iteration
+    AVX512, // 16 texels per iteration
+};
+
+// Fills count texels of one row; texel i is centered at (fx + i, fy) relative to the shape center
+typedef void (*SDFRowKernel)(int8_t* dst, int count, float fx, float fy, float radius);
+
+struct SDFKernels
+{
+    SimdLevel level;
+    SDFRowKernel circleRow;
+    SDFRowKernel boxRow; // radius is the half extent
+
+    // Best level supported by the CPU, detected once at startup
+    static SimdLevel detect();
+    static const SDFKernels& get();
+
+    // Falls back to the best supported level if the requested one isn't available
+    static const SDFKernels& get(SimdLevel level);
+
+    static const char* name(SimdLevel level);
+
+    // Bakes are split into strips of whole rows of about this many texels, one strip per task
+    static constexpr int TILE_TEXELS = 64 * 1024;
+    static int tileRows(int texSize);
+
+    // Fills rows [y0, y0 + rows) of a texSize x texSize field centered in the texture
+    static void bakeRows(SDFRowKernel rowKernel, int texSize, float radius, int8_t* texData, int y0, int rows);
+};
+
+#endif //__SDFKERNELS_H__
@@ -0,0 +1,61 @@
+#include "SDFMask.h"
+
+#include <algorithm>
+#include <cmath>
+
+void SDFMask::rasterize(bool circle, int size, float radius, uint8_t* mask, ThreadPool& pool)
+{
+    const float origin = -(size / 2) + 0.5f;
+    const float radius2 = radius * radius;
+    pool.parallelFor(size, [&](int y)
+    {
+        const float py = origin + y;
+        uint8_t* row = &mask[size_t(y) * size];
+        for (int x = 0; x < size; ++x)
+        {
+            const float px = origin + x;
+            row[x] = circle ? px*px + py*py <= radius2 : fabsf(px) <= radius && fabsf(py) <= radius;
+        }
+    });
+}
+
+void SDFMask::coverage(bool circle, int size, float radius, uint8_t* coverage, ThreadPool& pool)
+{
+    const float origin = -(size / 2) + 0.5f;
+    const float radius2 = radius * radius;
+    const float step = 1.f / COVERAGE_SAMPLES;
+    const int samples = COVERAGE_SAMPLES * COVERAGE_SAMPLES;
+    pool.parallelFor(size, [&](int y)
+    {
+        const float py = origin + y;
+        uint8_t* row = &coverage[size_t(y) * size];
+        for (int x = 0; x < size; ++x)
+        {
+            // Texels further than half a diagonal from the edge are all in or all out
+            const float px = origin + x;
+            const float dist = circle ? sqrtf(px*px + py*py) - radius : std::max(fabsf(px), fabsf(py)) - radius;
+            if (dist >= 0.75f)
+            {
+                row[x] = 0;
+                continue;
+            }
+            if (dist <= -0.75f)
+            {
+                row[x] = 255;
+                continue;
+            }
+
+            int inside = 0;
+            for (int j = 0; j < COVERAGE_SAMPLES; ++j)
+            {
+                const float sy = py - 0.5f + (j + 0.5f) * step;
+                for (int i = 0; i < COVERAGE_SAMPLES; ++i)
+                {
+                    const float sx = px - 0.5f + (i + 0.5f) * step;
+                    inside += circle ? sx*sx + sy*sy <= radius2 : fabsf(sx) <= radius && fabsf(sy) <= radius;
+                }
+            }
+            row[x] = uint8_t((inside * 255 + samples / 2) / samples);
+        }
+    });
+}
@@ -0,0 +1,24 @@
+#ifndef __SDFMASK_H__
+#define __SDFMASK_H__
+
+#include "ThreadPool.h"
+
+#include <cstdint>
+
+// Masks of the scene's shapes for the generators that build a field from a mask rather than a formula
+// NOTE texels are centered the same way as SDFKernels::bakeRows, so a mask field lines up with the kernel field
+struct SDFMask
+{
+    // Fills a size x size mask with 1 inside the shape and 0 outside
+    static void rasterize(bool circle, int size, float radius, uint8_t* mask, ThreadPool& pool);
+
+    // Fills a size x size image with how much of each texel is inside the shape, from 0 to 255
+    // NOTE only texels near the edge are supersampled, on a COVERAGE_SAMPLES x COVERAGE_SAMPLES grid
+    static void coverage(bool circle, int size, float radius, uint8_t* coverage, ThreadPool& pool);
+    static constexpr int COVERAGE_SAMPLES = 16;
+
+    // Signed distance in texels, positive inside, to the same snorm bytes the kernels produce
+    static int8_t encode(float distance, float radius) {return int8_t(int32_t(distance * 127 / radius));}
+};
+
+#endif //__SDFMASK_H__
@@ -1,138 +1,369 @@
 #include "SDFScene.h"
+#include "SDFKernels.h"
+#include "ThreadPool.h"
+#include "ScratchArena.h"
+#include "SDFMask.h"
+#include "DistanceTransform.h"
+#include "JumpFlood.h"
+#include "CoverageTransform.h"
+#include "MaskImage.h"
+#include "Shader.h"
+#include "Trace.h"
 
 #include <cstdint>
 #include <cstdio>
-#include <memory>
 #include <cmath>
 #include <algorithm>
+#include <string>
 
-static GLuint loadShader(const char* shaderCode, GLenum shaderType)
+static constexpr int MAX_TEX_POW = 14;
+
+// NOTE not declared by the macOS 4.1 headers, so it's looked up at runtime
+typedef void (*TexStorage2DProc)(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height);
+static TexStorage2DProc s_glTexStorage2D = nullptr;
+
+static void uploadRows(int layer, int texSize, int y0, int rows, const void* texData)
 {
-    // Compile the shader file
-    GLuint shader = glCreateShader(shaderType);
-    const char* sourceArray[] = {shaderCode};
-    glShaderSource(shader, 1, sourceArray, NULL);
-    glCompileShader(shader);
+    // A negative layer means the plain 2D texture rather than the frame cache
+    if (layer < 0)
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, texSize, rows, GL_RED, GL_BYTE, texData);
+    else
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, y0, layer, texSize, rows, 1, GL_RED, GL_BYTE, texData);
+}
 
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+int8_t* SDFScene::mapNextBuffer(GLsizeiptr bytes)
+{
+    // Cycle through the ring so we aren't mapping a buffer the GPU may still be copying from
+    const int index = m_pboIndex;
+    m_pboIndex = (m_pboIndex + 1) % PBO_RING_SIZE;
 
-    if (success == GL_FALSE)
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbos[index]);
+    if (m_pboBytes[index] != bytes)
     {
-        // Get the length of the error log
-        GLint logLength = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
-
-        // Get the error log and print
-        char* errorLog = new char [logLength];
-        glGetShaderInfoLog(shader, logLength, &logLength, errorLog);
-        fprintf(stderr, "%s\n", errorLog);
-        delete[] errorLog;
-
-        // Exit with failure
-        glDeleteShader(shader);
-        return 0;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        m_pboBytes[index] = bytes;
     }
 
-    return shader;
+    auto data = static_cast<int8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (!data)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return data;
 }
 
-static void makeCircle(int texSize, float radius)
+bool SDFScene::bakeTiles(SDFRowKernel rowKernel, int texSize, float radius, int layer)
 {
-    auto texData = std::make_unique<int8_t[]>(texSize * texSize);
-    for (int y = 0; y < texSize; ++y)
+    const int tileRows = SDFKernels::tileRows(texSize);
+    const int tileTexels = tileRows * texSize;
+    const int tiles = texSize / tileRows;
+    const int slots = std::min(m_pool.size(), tiles);
+
+    // Keep every slot on its own cache lines
+    const size_t slotBytes = ScratchArena::align(tileTexels);
+    const size_t batchBytes = slots * slotBytes;
+
+    // NOTE a buffer only ever holds one batch of tiles, so staging stays at one tile per worker for each slot in the ring
+    bool usePBO = m_usePBO.get();
+    double uploadTime = 0.0;
+    for (int first = 0; first < tiles;)
     {
-        const float fy = y - (texSize / 2) + 0.5f;
-        for (int x = 0; x < texSize; ++x)
+        const int count = std::min(slots, tiles - first);
+
+        // Workers write straight into driver memory when a buffer maps, so there's no client copy at all
+        int8_t* tileData = usePBO ? mapNextBuffer(GLsizeiptr(batchBytes)) : m_arena.get<int8_t>(batchBytes);
+        if (!tileData)
         {
-            const float fx = x - (texSize / 2) + 0.5f;
-            texData[y*texSize+x] = (radius - sqrtf(fx*fx+fy*fy)) * 127 / radius;
-            //printf("%d ", int(texData[y*texSize+x]));
+            if (!usePBO)
+                return false;
+
+            // Bake the rest in client memory if the driver won't map a buffer
+            usePBO = false;
+            continue;
         }
-        //printf("\n");
-    }
 
-    //glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, 4, 4, 0, GL_RED, GL_UNSIGNED_BYTE, texData);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8_SNORM, texSize, texSize, 0, GL_RED, GL_BYTE, texData.get());
-}
+        m_pool.parallelFor(count, [&](int slot)
+        {
+            TRACE_SCOPE("bakeTile");
+            SDFKernels::bakeRows(rowKernel, texSize, radius, &tileData[slot * slotBytes], (first + slot) * tileRows, tileRows);
+        });
 
-static void makeSquare(int texSize, float radius)
-{
-    auto texData = std::make_unique<int8_t[]>(texSize * texSize);
-    for (int y = 0; y < texSize; ++y)
-    {
-        const float fy = y - (texSize / 2) + 0.5f;
-        const bool insideY = fy >= -radius || fy <= radius;
-        
-        for (int x = 0; x < texSize; ++x)
+        // Upload the finished tiles before their slots get reused; out of a buffer the copy is queued
+        // rather than waited on, and the rows are read from offsets into it
+        TRACE_SCOPE("upload");
+        const double uploadStart = glfwGetTime();
+        m_uploadTimer.begin();
+        const bool unmapped = usePBO && glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+        if (usePBO && !unmapped)
         {
-            const float fx = x - (texSize / 2) + 0.5f;
-            const bool insideX = fx >= -radius || fx <= radius;
-            
-            if (insideX)
-            {
-                if (insideY)
-                {
-                    texData[y*texSize+x] = std::min
-                    ({
-                        radius - fx,
-                        radius + fx,
-                        radius - fy,
-                        radius + fy
-                    }) * 127 / radius;
-                }
-                else
-                {
-                    texData[y*texSize+x] = (radius - fabsf(fy)) * 127 / radius;
-                }
-            }
-            else
+            // The buffer's contents were lost, so this batch is baked again in client memory
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            usePBO = false;
+        }
+        else
+        {
+            for (int slot = 0; slot < count; ++slot)
             {
-                if (insideY)
-                {
-                    texData[y*texSize+x] = (radius - fabsf(fx)) * 127 / radius;
-                }
-                else
-                {
-                    texData[y*texSize+x] = std::min
-                    ({
-                        sqrtf((fx-radius)*(fx-radius) + (fy-radius)*(fy-radius)),
-                        sqrtf((fx-radius)*(fx-radius) + (fy+radius)*(fy+radius)),
-                        sqrtf((fx+radius)*(fx+radius) + (fy-radius)*(fy-radius)),
-                        sqrtf((fx+radius)*(fx+radius) + (fy+radius)*(fy+radius))
-                    }) * -127 / radius;
-                }
+                const size_t offset = slot * slotBytes;
+                uploadRows(layer, texSize, (first + slot) * tileRows, tileRows,
+                    usePBO ? reinterpret_cast<const void*>(offset) : &tileData[offset]);
             }
-            //printf("%d ", int(texData[y*texSize+x]));
+            first += count;
         }
-        //printf("\n");
+        m_uploadTimer.end();
+        uploadTime += glfwGetTime() - uploadStart;
     }
 
-    //glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, 4, 4, 0, GL_RED, GL_UNSIGNED_BYTE, texData);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8_SNORM, texSize, texSize, 0, GL_RED, GL_BYTE, texData.get());
+    // NOTE must unbind or AntTweakBar's own uploads would read from our buffer
+    if (usePBO)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_uploadMs = uploadTime * 1000.0;
+    return true;
 }
 
-void SDFScene::computeSDF()
+bool SDFScene::bakeGenerated(int texSize, float radius, int layer)
 {
-    glBindTexture(GL_TEXTURE_2D, m_texture);
+    uint8_t* mask = m_mask.get<uint8_t>(size_t(texSize) * texSize);
+    int8_t* texData = m_arena.get<int8_t>(size_t(texSize) * texSize);
+    if (!mask || !texData)
+        return false;
 
-    float size = exp2(m_texPow.get());
-    float radius = m_radius.get() * size * 0.01f;
-    if (m_drawCircle.get())
-        makeCircle(size, radius);
-    else
-        makeSquare(size, radius);
+    // The coverage generator reads an anti-aliased image instead of a binary mask
+    const Generator generator = m_generator.get();
+    loadMask(mask, texSize, radius, generator == GENERATOR_COVERAGE);
+
+    {
+        TRACE_SCOPE("distanceTransform");
+        bool generated;
+        if (generator == GENERATOR_COVERAGE)
+            generated = CoverageTransform::generate(mask, texSize, radius, texData, m_pool, m_generatorScratch);
+        else if (generator == GENERATOR_JFA)
+            generated = JumpFlood::generate(mask, texSize, radius, texData, m_pool, m_generatorScratch);
+        else
+            generated = DistanceTransform::generate(mask, texSize, radius, texData, m_pool, m_generatorScratch);
+        if (!generated)
+            return false;
+    }
+
+    // NOTE the transform needs the whole mask before any row is final, so there are no tiles to stream;
+    // the field is already whole in client memory, and copying it through the buffers would cost as much again
+    TRACE_SCOPE("upload");
+    const double uploadStart = glfwGetTime();
+    m_uploadTimer.begin();
+    uploadRows(layer, texSize, 0, texSize, texData);
+    m_uploadTimer.end();
+    m_uploadMs = (glfwGetTime() - uploadStart) * 1000.0;
+    return true;
 }
 
-bool SDFScene::init()
+void SDFScene::loadMask(uint8_t* mask, int texSize, float radius, bool coverage)
+{
+    if (!m_maskPath)
+    {
+        TRACE_SCOPE("rasterize");
+        if (coverage)
+            SDFMask::coverage(m_drawCircle.get(), texSize, radius, mask, m_pool);
+        else
+            SDFMask::rasterize(m_drawCircle.get(), texSize, radius, mask, m_pool);
+        return;
+    }
+
+    // An image doesn't depend on the radius, so it's only decoded again for a new size or kind of mask
+    if (m_loadedMaskSize == texSize && m_loadedMaskCoverage == coverage)
+        return;
+
+    TRACE_SCOPE("loadMask");
+    m_loadedMaskSize = 0;
+    if (!MaskImage::load(m_maskPath, texSize, !coverage, m_maskInvert, mask))
+    {
+        // Don't retry every frame; the shape is drawn from here on
+        fprintf(stderr, "Failed to load mask %s, drawing the shape instead\n", m_maskPath);
+        m_maskPath = nullptr;
+        loadMask(mask, texSize, radius, coverage);
+        return;
+    }
+    m_loadedMaskSize = texSize;
+    m_loadedMaskCoverage = coverage;
+}
+
+void SDFScene::setMaskImage(const char* path, bool invert)
+{
+    m_maskPath = path;
+    m_maskInvert = invert;
+
+    // The shape generator has nothing to read an image with
+    m_generator.set(GENERATOR_EDT);
+}
+
+void SDFScene::allocateTexture(int texSize)
 {
+    // Immutable storage can't be respecified, so a new size needs a new texture object
+    if (m_texture)
+        glDeleteTextures(1, &m_texture);
+
     glGenTextures(1, &m_texture);
     glBindTexture(GL_TEXTURE_2D, m_texture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_useBilinear.get() ? GL_LINEAR : GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    
+
+    if (s_glTexStorage2D)
+    {
+        s_glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8_SNORM, texSize, texSize);
+    }
+    else
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8_SNORM, texSize, texSize, 0, GL_RED, GL_BYTE, nullptr);
+    }
+
+    m_texSize = texSize;
+}
+
+void SDFScene::releaseTexture()
+{
+    if (m_texture)
+    {
+        glDeleteTextures(1, &m_texture);
+        m_texture = 0;
+        m_texSize = 0;
+    }
+}
+
+void SDFScene::releaseBuffers()
+{
+    for (int i = 0; i < PBO_RING_SIZE; ++i)
+    {
+        if (m_pboBytes[i] == 0)
+            continue;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbos[i]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, 0, nullptr, GL_STREAM_DRAW);
+        m_pboBytes[i] = 0;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void SDFScene::computeSDF()
+{
+    TRACE_SCOPE("computeSDF");
+
+    // Nothing to bake; the analytic shader evaluates the shape per pixel
+    if (m_analytic.get())
+    {
+        releaseTexture();
+        releaseBuffers();
+        m_frameCache.release();
+        m_cacheLayer = -1;
+        return;
+    }
+
+    float size = exp2(m_texPow.get());
+    float radius = m_frameRadius * size * 0.01f;
+    m_rawScale = 0.f;
+    m_cacheLayer = -1;
+
+    // The raw field is only baked once anyway, so it never goes through the cache
+    const GLint filter = m_useBilinear.get() ? GL_LINEAR : GL_NEAREST;
+    const size_t cacheBytes = size_t(m_cacheMB.get()) << 20;
+    SDFFrameCache::Key key = {};
+    if (m_useCache.get() && !useRawDistance() && m_frameCache.reserve(size, cacheBytes, filter))
+    {
+        // NOTE the plain texture isn't needed while frames come out of the cache
+        releaseTexture();
+
+        // Snap the radius so a layer holds exactly the frame its key describes
+        key = cacheKey(m_frameRadius);
+        bool hit = false;
+        m_cacheLayer = m_frameCache.lookup(key, hit);
+        if (hit)
+            return;
+
+        radius = key.radiusStep * m_radiusStep.get() * size * 0.01f;
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_frameCache.texture());
+    }
+    else
+    {
+        m_frameCache.release();
+
+        if (m_texSize != int(size))
+            allocateTexture(size);
+        else
+            glBindTexture(GL_TEXTURE_2D, m_texture);
+
+        if (useRawDistance())
+        {
+            // Bake at a radius that covers the whole texture so (radius - d) / radius never overflows;
+            // the shader turns it back into a distance and applies the real radius
+            radius = size * sqrtf(0.5f);
+            m_rawScale = radius;
+        }
+    }
+
+    bool baked;
+    if (m_generator.get() != GENERATOR_SHAPE)
+    {
+        baked = bakeGenerated(size, radius, m_cacheLayer);
+    }
+    else
+    {
+        const SDFRowKernel rowKernel = m_drawCircle.get() ? SDFKernels::get().circleRow : SDFKernels::get().boxRow;
+        baked = bakeTiles(rowKernel, size, radius, m_cacheLayer);
+    }
+    if (!baked)
+        return;
+
+    if (m_cacheLayer >= 0)
+        m_frameCache.store(m_cacheLayer, key);
+    ++m_bakes;
+}
+
+bool SDFScene::needsBake(uint32_t dirty) const
+{
+    // Neither the raw field nor the analytic shader depend on the radius; render just passes it along
+    if (dirty & DIRTY_FIELD)
+        return true;
+    return (dirty & DIRTY_RADIUS) && !useRawDistance() && !m_analytic.get();
+}
+
+bool SDFScene::drawsWithoutBake(float radius) const
+{
+    // Neither the raw field nor the analytic shader depend on the radius, and a cached frame is just another layer
+    if (m_analytic.get() || useRawDistance())
+        return true;
+    return m_useCache.get() && m_frameCache.contains(cacheKey(radius));
+}
+
+SDFFrameCache::Key SDFScene::cacheKey(float radius) const
+{
+    return {m_drawCircle.get(), m_generator.get(), m_texPow.get(), int32_t(lroundf(radius / m_radiusStep.get()))};
+}
+
+bool SDFScene::useRawDistance() const
+{
+    // A generated field comes from a mask of one radius, so there's no radius independent form of it; nor is there
+    // for the square, whose box grows with the radius rather than being offset by it like the circle's distance is
+    return m_rawDistance.get() && m_generator.get() == GENERATOR_SHAPE && m_drawCircle.get();
+}
+
+void SDFScene::markDirty(uint32_t dirty)
+{
+    // A bake was already pending, so this change would otherwise have cost one of its own
+    if (needsBake(dirty) && needsBake(m_dirty))
+        ++m_bakesAvoided;
+    m_dirty |= dirty;
+}
+
+bool SDFScene::init()
+{
+    // glTexStorage2D is core in 4.2, but we only ask for a 4.1 context
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 4 || (major == 4 && minor >= 2) || glfwExtensionSupported("GL_ARB_texture_storage"))
+        s_glTexStorage2D = reinterpret_cast<TexStorage2DProc>(glfwGetProcAddress("glTexStorage2D"));
+
+    glGenBuffers(PBO_RING_SIZE, m_pbos);
+
     computeSDF();
 
     glGenVertexArrays(1, &m_vao);
@@ -158,14 +389,18 @@ bool SDFScene::init()
     "gl_Position = vec4((a_vertex - vec2(0.5, 0.5)) * 2, 0.0, 1.0);\n"
     "}\n";
 
-    const char* fragmentShader =
+    // Everything after the distance lookup is shared by the texture and analytic shaders
+    const char* fragmentShade =
     "#version 410\n"
-    "uniform sampler2D u_texture;\n"
     "uniform float u_useSDFShader;\n"
     "in vec2 v_texCoord;\n"
     "out vec4 f_color;\n"
-    "void main() {\n"
-    "float sdfSample = texture(u_texture, v_texCoord).r;\n"
+    // Same narrowing as the bake, including the int8 wraparound
+    "float narrowSample(float value) {\n"
+    "value = trunc(value);\n"
+    "return max((mod(value + 128.0, 256.0) - 128.0) / 127.0, -1.0);\n"
+    "}\n"
+    "void shade(float sdfSample) {\n"
     "vec3 unshadedColor = sdfSample * vec3(1, 1, 1);\n"
     "float mask_outout = step(-0.46, sdfSample);\n"
     "float mask_outin = step(-0.4, sdfSample);\n"
@@ -193,62 +428,152 @@ bool SDFScene::init()
     //"f_color = vec4(r, g, b, 1.0);\n"
     "}\n";
 
-    m_shader = glCreateProgram();
-    glAttachShader(m_shader, loadShader(vertexShader, GL_VERTEX_SHADER));
-    glAttachShader(m_shader, loadShader(fragmentShader, GL_FRAGMENT_SHADER));
-    glLinkProgram(m_shader);
+    const char* textureMain =
+    "uniform sampler2D u_texture;\n"
+    "uniform float u_rawScale;\n"
+    "uniform float u_radius;\n"
+    "void main() {\n"
+    "float sdfSample = texture(u_texture, v_texCoord).r;\n"
+    // Raw distance mode; redo the bake's math with the current radius
+    "if (u_rawScale > 0.0) {\n"
+    "float dist = u_rawScale * (1.0 - sdfSample);\n"
+    "sdfSample = narrowSample((u_radius - dist) * 127.0 / u_radius);\n"
+    "}\n"
+    "shade(sdfSample);\n"
+    "}\n";
 
-    GLint success;
-    glGetProgramiv(m_shader, GL_LINK_STATUS, &success);
+    const char* cacheMain =
+    "uniform sampler2DArray u_frames;\n"
+    "uniform float u_layer;\n"
+    "void main() {\n"
+    "shade(texture(u_frames, vec3(v_texCoord, u_layer)).r);\n"
+    "}\n";
 
-    if (success == GL_FALSE)
-    {
-        // Get the length of the error log
-        GLint logLength = 0;
-        glGetProgramiv(m_shader, GL_INFO_LOG_LENGTH, &logLength);
-
-        // Get the error log and print
-        char* errorLog = new char [logLength];
-        glGetProgramInfoLog(m_shader, logLength, &logLength, errorLog);
-        fprintf(stderr, "%s\n", errorLog);
-        delete[] errorLog;
-
-        // Exit with failure
-        glDeleteProgram(m_shader);
-        m_shader = 0;
+    // Evaluates the shape per pixel in texture space; u_radius is a fraction of the texture size
+    const char* analyticMain =
+    "uniform float u_radius;\n"
+    "uniform float u_drawCircle;\n"
+    "void main() {\n"
+    "vec2 p = v_texCoord - vec2(0.5, 0.5);\n"
+    "vec2 q = abs(p) - vec2(u_radius, u_radius);\n"
+    "float boxDist = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0);\n"
+    "float circleDist = length(p) - u_radius;\n"
+    "float dist = mix(boxDist, circleDist, u_drawCircle);\n"
+    "shade(narrowSample(-dist * 127.0 / u_radius));\n"
+    "}\n";
+
+    m_shader = Shader::loadProgram(vertexShader, std::string(fragmentShade) + textureMain);
+    m_analyticShader = Shader::loadProgram(vertexShader, std::string(fragmentShade) + analyticMain);
+    m_cacheShader = Shader::loadProgram(vertexShader, std::string(fragmentShade) + cacheMain);
+    if (!m_shader || !m_analyticShader || !m_cacheShader)
         return false;
-    }
+
+    m_rawScaleLoc = glGetUniformLocation(m_shader, "u_rawScale");
+    m_radiusLoc = glGetUniformLocation(m_shader, "u_radius");
+    m_analyticRadiusLoc = glGetUniformLocation(m_analyticShader, "u_radius");
+    m_drawCircleLoc = glGetUniformLocation(m_analyticShader, "u_drawCircle");
+    m_layerLoc = glGetUniformLocation(m_cacheShader, "u_layer");
 
     glUseProgram(m_shader);
     glUniform1i(glGetUniformLocation(m_shader, "u_texture"), 0);
     glUniform1f(glGetUniformLocation(m_shader, "u_useSDFShader"), m_useSDFShader.get() ? 1.f : 0.f);
+    glUseProgram(m_analyticShader);
+    glUniform1f(glGetUniformLocation(m_analyticShader, "u_useSDFShader"), m_useSDFShader.get() ? 1.f : 0.f);
+    glUseProgram(m_cacheShader);
+    glUniform1i(glGetUniformLocation(m_cacheShader, "u_frames"), 0);
+    glUniform1f(glGetUniformLocation(m_cacheShader, "u_useSDFShader"), m_useSDFShader.get() ? 1.f : 0.f);
     glUseProgram(0);
 
     // Create tweak bar
     //TwSetCurrentWindow(...);
-    m_tweakBar = TwNewBar("TweakBar");
-    TwDefine(" TweakBar size='150 400' color='96 216 224' fontsize=3 "); // "fontscaling=fb/window"
-    m_drawCircle.init(m_tweakBar, "Draw Circle", "", std::bind(&SDFScene::computeSDF, this));
-    m_useBilinear.init(m_tweakBar, "Bilinear Filter", "", [texture=m_texture](bool useBilinear)
+    m_tweakBar = TwNewBar(m_name);
+    char barDef[128];
+    snprintf(barDef, sizeof(barDef), " %s size='150 400' color='96 216 224' fontsize=3 ", m_name); // "fontscaling=fb/window"
+    TwDefine(barDef);
+    m_drawCircle.init(m_tweakBar, "Draw Circle", "", std::bind(&SDFScene::markDirty, this, DIRTY_FIELD));
+    m_useBilinear.init(m_tweakBar, "Bilinear Filter", "", [this](bool useBilinear)
     {
-        glBindTexture(GL_TEXTURE_2D, texture);
+        glBindTexture(GL_TEXTURE_2D, m_texture);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, useBilinear ? GL_LINEAR : GL_NEAREST);
         glBindTexture(GL_TEXTURE_2D, 0);
+        m_frameCache.setFilter(useBilinear ? GL_LINEAR : GL_NEAREST);
     });
-    m_useSDFShader.init(m_tweakBar, "SDF Shader", "", [shader=m_shader](bool useSDF)
+    m_useSDFShader.init(m_tweakBar, "SDF Shader", "", [this](bool useSDF)
     {
-        glUseProgram(shader);
-        glUniform1f(glGetUniformLocation(shader, "u_useSDFShader"), useSDF ? 1.f : 0.f);
+        for (GLuint shader : {m_shader, m_analyticShader, m_cacheShader})
+        {
+            glUseProgram(shader);
+            glUniform1f(glGetUniformLocation(shader, "u_useSDFShader"), useSDF ? 1.f : 0.f);
+        }
         glUseProgram(0);
     });
-    m_texPow.init(m_tweakBar, "Tex Pow", " min=2 max=6 ", std::bind(&SDFScene::computeSDF, this));
-    m_radius.init(m_tweakBar, "Radius", " min=0.1 max=100 step=0.1 ", std::bind(&SDFScene::computeSDF, this));
+    GLint maxTexSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
+    const int maxTexPow = std::min(int(log2(maxTexSize)), MAX_TEX_POW);
+    char texPowDef[32];
+    snprintf(texPowDef, sizeof(texPowDef), " min=2 max=%d ", maxTexPow);
+    m_texPow.init(m_tweakBar, "Tex Pow", texPowDef, std::bind(&SDFScene::markDirty, this, DIRTY_FIELD));
+    m_radius.init(m_tweakBar, "Radius", " min=0.1 max=100 step=0.1 ", [this](float radius)
+    {
+        // Jump straight to the new radius instead of interpolating towards it
+        m_prevRadius = radius;
+        m_frameRadius = radius;
+        markDirty(DIRTY_RADIUS);
+    });
+    m_animate.init(m_tweakBar, "Animate", "", [this](bool) {requestRedraw();});
+    static const TwEnumVal generatorValues[] = {{GENERATOR_SHAPE, "Shape"}, {GENERATOR_EDT, "EDT"}, {GENERATOR_JFA, "JFA"}, {GENERATOR_COVERAGE, "Coverage"}};
+    static const TwType generatorType = TwDefineEnum("Generator", generatorValues, sizeof(generatorValues) / sizeof(generatorValues[0]));
+    m_generator.init(m_tweakBar, "Generator", generatorType, " help='Shape bakes the closed form; EDT and JFA transform a mask of the shape, exactly or by jump flooding; Coverage transforms an anti-aliased image of it to within a fraction of a texel' ",
+        std::bind(&SDFScene::markDirty, this, DIRTY_FIELD));
+    m_rawDistance.init(m_tweakBar, "Raw Distance", "", std::bind(&SDFScene::markDirty, this, DIRTY_FIELD));
+    m_analytic.init(m_tweakBar, "Analytic SDF", "", std::bind(&SDFScene::markDirty, this, DIRTY_FIELD));
+
+    // NOTE the pool is shared by every scene, so the bar reads its size back rather than keeping a copy
+    char threadsDef[64];
+    snprintf(threadsDef, sizeof(threadsDef), " min=1 max=%d help='Shared by every scene' ", ThreadPool::hardwareThreads());
+    TwAddVarCB(m_tweakBar, "Threads", TW_TYPE_INT32, [](const void* value, void* pool)
+    {
+        static_cast<ThreadPool*>(pool)->resize(*static_cast<const int32_t*>(value));
+    }, [](void* value, void* pool)
+    {
+        *static_cast<int32_t*>(value) = static_cast<ThreadPool*>(pool)->size();
+    }, &m_pool, threadsDef);
+
+    m_useCache.init(m_tweakBar, "Frame Cache", "", std::bind(&SDFScene::markDirty, this, DIRTY_FIELD));
+    m_cacheMB.init(m_tweakBar, "Cache MB", " min=1 max=4096 ", std::bind(&SDFScene::markDirty, this, DIRTY_FIELD));
+    m_radiusStep.init(m_tweakBar, "Radius Step", " min=0.001 max=1 step=0.001 ", [this](float)
+    {
+        // Keys are in units of the old step, so none of them mean the same frame anymore
+        m_frameCache.clear();
+        markDirty(DIRTY_FIELD);
+    });
+    TwAddVarCB(m_tweakBar, "Cache Hits", TW_TYPE_UINT32, nullptr, [](void* value, void* cache)
+    {
+        *static_cast<uint32_t*>(value) = static_cast<SDFFrameCache*>(cache)->hits();
+    }, &m_frameCache, "");
+    TwAddVarCB(m_tweakBar, "Cache Misses", TW_TYPE_UINT32, nullptr, [](void* value, void* cache)
+    {
+        *static_cast<uint32_t*>(value) = static_cast<SDFFrameCache*>(cache)->misses();
+    }, &m_frameCache, "");
+
+    m_usePBO.init(m_tweakBar, "PBO Upload", "", std::bind(&SDFScene::markDirty, this, DIRTY_FIELD));
+    TwAddVarRO(m_tweakBar, "Bakes", TW_TYPE_UINT32, &m_bakes, " help='Fields baked since startup' ");
+    TwAddVarRO(m_tweakBar, "Bakes Avoided", TW_TYPE_UINT32, &m_bakesAvoided, " help='Bakes saved by coalescing parameter changes into one per frame' ");
+    TwAddVarRO(m_tweakBar, "Upload ms", TW_TYPE_FLOAT, &m_uploadMs, " precision=3 help='CPU time spent in the last texture upload' ");
+
+    TwAddVarCB(m_tweakBar, "Allocations", TW_TYPE_UINT32, nullptr, [](void* value, void* arena)
+    {
+        *static_cast<uint32_t*>(value) = static_cast<ScratchArena*>(arena)->allocations();
+    }, &m_arena, " help='Heap allocations made by the bake scratch arena' ");
     
     return true;
 }
 
 void SDFScene::close()
 {
+    m_uploadTimer.release();
+    m_frameCache.release();
+
     if (m_tweakBar)
     {
         TwDeleteBar(m_tweakBar);
@@ -256,37 +581,88 @@ void SDFScene::close()
     }
 }
 
-void SDFScene::render()
+void SDFScene::prepare(double alpha)
+{
+    // Upload times from a couple of frames ago, if the GPU has finished with them
+    float gpuMs = 0.f;
+    if (m_uploadTimer.resolve(gpuMs) && m_frameStats)
+        m_frameStats->sample(FrameStats::PHASE_GPU_UPLOAD, gpuMs);
+
+    // Interpolate the radius between the last two ticks when that costs no bake; otherwise the frames between
+    // ticks draw the last tick's radius, so bakes run at the tick rate rather than the frame rate
+    float radius = m_prevRadius + (m_radius.get() - m_prevRadius) * float(alpha);
+    if (!drawsWithoutBake(radius))
+        radius = m_radius.get();
+    if (radius != m_frameRadius)
+    {
+        m_frameRadius = radius;
+        markDirty(DIRTY_RADIUS);
+    }
+
+    // Whatever changed since the last frame, bake at most once with the latest values
+    if (needsBake(m_dirty))
+        computeSDF();
+    m_dirty = 0;
+}
+
+void SDFScene::render(double alpha)
 {
     // render scene
-    glUseProgram(m_shader);
-    glBindTexture(GL_TEXTURE_2D, m_texture);
+    if (m_analytic.get())
+    {
+        glUseProgram(m_analyticShader);
+        glUniform1f(m_analyticRadiusLoc, m_frameRadius * 0.01f);
+        glUniform1f(m_drawCircleLoc, m_drawCircle.get() ? 1.f : 0.f);
+    }
+    else if (m_cacheLayer >= 0)
+    {
+        glUseProgram(m_cacheShader);
+        glUniform1f(m_layerLoc, float(m_cacheLayer));
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_frameCache.texture());
+    }
+    else
+    {
+        glUseProgram(m_shader);
+        glUniform1f(m_rawScaleLoc, m_rawScale);
+        glUniform1f(m_radiusLoc, m_frameRadius * m_texSize * 0.01f);
+        glBindTexture(GL_TEXTURE_2D, m_texture);
+    }
     glBindVertexArray(m_vao);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
     glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
     glUseProgram(0);
-    
-    // Draw TweakBar on top
-    //TwRefreshBar(tweakBar); // only necessary if we update parameters externally
-    TwDraw();
 }
 
-void SDFScene::update(double elapsedTime)
+void SDFScene::update(double tickTime)
 {
-    static double counter = 0;
-    static float scale = 0.99f;
-    counter += elapsedTime;
-    bool updated = false;
-    while (counter > 0.016)
+    // NOTE the animation moves a fixed amount per tick; the tick rate sets its speed
+    const float radius = m_radius.get();
+    if (!m_animate.get())
     {
-        updated = true;
-        float radius = m_radius.get();
-        if (radius < 0.8f) scale = 1.01;
-        else if (radius > 4.f) scale = 0.99f;
-        m_radius.set(radius * scale);
-        counter -= 0.1;
+        m_prevRadius = radius;
+        return;
     }
-    if (updated)
-        computeSDF();
+
+    if (radius < 0.8f) m_animScale = 1.01f;
+    else if (radius > 4.f) m_animScale = 0.99f;
+    m_prevRadius = radius;
+    m_radius.set(radius * m_animScale);
+}
+
+bool SDFScene::animating() const
+{
+    // Keep drawing until the interpolated radius has caught up after pausing
+    return m_animate.get() || m_prevRadius != m_radius.get() || m_frameRadius != m_radius.get() || m_dirty != 0;
+}
+
+void SDFScene::setActive(bool active)
+{
+    if (!m_tweakBar)
+        return;
+
+    char barDef[64];
+    snprintf(barDef, sizeof(barDef), " %s visible=%s ", m_name, active ? "true" : "false");
+    TwDefine(barDef);
 }
@@ -3,6 +3,11 @@
 
 #include "GlfwInstance.h"
 #include "TwWrapper.h"
+#include "ThreadPool.h"
+#include "ScratchArena.h"
+#include "SDFKernels.h"
+#include "SDFFrameCache.h"
+#include "GpuTimer.h"
 
 #include <cstdint>
 
@@ -11,29 +16,126 @@ class SDFScene : public Scene
 public:
     // NOTE have to move these before the template decl
     void computeSDF();
+    void markDirty(uint32_t dirty);
+
+    // Where the field comes from: the kernels' closed form, or a transform of the shape's mask
+    enum Generator : int32_t
+    {
+        GENERATOR_SHAPE,
+        GENERATOR_EDT,
+        GENERATOR_JFA,
+        GENERATOR_COVERAGE,
+    };
 
 private:
+    // Parameter changes are collected here and baked once per frame in prepare
+    enum DirtyFlags : uint32_t
+    {
+        DIRTY_RADIUS = 1 << 0,
+        DIRTY_FIELD = 1 << 1,
+    };
+
+    const char* m_name;
     TwBar* m_tweakBar;
     GLuint m_texture;
+    int m_texSize;
     GLuint m_shader;
+    GLint m_rawScaleLoc, m_radiusLoc;
+    GLuint m_analyticShader;
+    GLint m_analyticRadiusLoc, m_drawCircleLoc;
+    GLuint m_cacheShader;
+    GLint m_layerLoc;
     GLuint m_vao, m_vbo;
     TwWrapper<int32_t> m_texPow;
     TwWrapper<float> m_radius;
     TwWrapper<bool> m_drawCircle;
     TwWrapper<bool> m_useBilinear;
     TwWrapper<bool> m_useSDFShader;
+    TwWrapper<bool> m_rawDistance;
+    TwWrapper<bool> m_analytic;
+    TwWrapper<bool> m_usePBO;
+    TwWrapper<bool> m_useCache;
+    TwWrapper<int32_t> m_cacheMB;
+    TwWrapper<float> m_radiusStep;
+    TwWrapper<bool> m_animate;
+    TwWrapper<Generator> m_generator;
+    ThreadPool& m_pool;
+    ScratchArena m_arena;
+    ScratchArena m_mask;
+    ScratchArena m_generatorScratch;
+
+    // Mask image the generators read instead of the shape, and what the mask arena last loaded from it
+    const char* m_maskPath;
+    bool m_maskInvert;
+    int m_loadedMaskSize;
+    bool m_loadedMaskCoverage;
+    SDFFrameCache m_frameCache;
+    int m_cacheLayer;
+    float m_uploadMs;
+    GpuTimer m_uploadTimer;
+    float m_rawScale;
+
+    // Animation state; the radius is interpolated between ticks when the frame needs no bake, and m_frameRadius is what was drawn
+    float m_animScale;
+    float m_prevRadius;
+    float m_frameRadius;
+
+    uint32_t m_dirty;
+    uint32_t m_bakesAvoided;
+    uint32_t m_bakes;
+
+    static constexpr int PBO_RING_SIZE = 3;
+    GLuint m_pbos[PBO_RING_SIZE];
+    GLsizeiptr m_pboBytes[PBO_RING_SIZE];
+    int m_pboIndex;
 
 public:
-    SDFScene(): m_tweakBar(nullptr), m_texture(0), m_shader(0), m_vao(0), m_vbo(0),
-        m_texPow(5), m_radius(4.f), m_drawCircle(true), m_useBilinear(true), m_useSDFShader(true) {}
+    // NOTE the name is also the tweak bar's, so it must be unique and can't contain spaces; the pool is
+    // shared with the other scenes and must outlive this one
+    SDFScene(const char* name, ThreadPool& pool): m_name(name), m_tweakBar(nullptr), m_texture(0), m_texSize(0), m_shader(0),
+        m_rawScaleLoc(-1), m_radiusLoc(-1), m_analyticShader(0), m_analyticRadiusLoc(-1), m_drawCircleLoc(-1),
+        m_cacheShader(0), m_layerLoc(-1), m_vao(0), m_vbo(0),
+        m_texPow(5), m_radius(4.f), m_drawCircle(true), m_useBilinear(true), m_useSDFShader(true),
+        m_rawDistance(false), m_analytic(false), m_usePBO(true),
+        m_useCache(false), m_cacheMB(64), m_radiusStep(0.02f), m_animate(true),
+        m_generator(GENERATOR_SHAPE), m_pool(pool),
+        m_maskPath(nullptr), m_maskInvert(false), m_loadedMaskSize(0), m_loadedMaskCoverage(false), m_cacheLayer(-1),
+        m_uploadMs(0.f), m_rawScale(0.f), m_animScale(0.99f), m_prevRadius(m_radius.get()),
+        m_frameRadius(m_radius.get()), m_dirty(0), m_bakesAvoided(0), m_bakes(0), m_pbos{}, m_pboBytes{}, m_pboIndex(0) {}
     ~SDFScene() {close();}
 
-    bool init();
-    void close();
+    bool init() override;
+    void close() override;
+
+    // Starting shape; must be set before init
+    void setDrawCircle(bool drawCircle) {m_drawCircle.set(drawCircle);}
+
+    // Bakes from a PGM or PNG mask instead of the shape, bright inside unless inverted; must be set before init
+    // NOTE the path isn't copied
+    void setMaskImage(const char* path, bool invert);
     
-    void render() override;
-    void update(double elapsedTime) override;
+    void prepare(double alpha) override;
+    void render(double alpha) override;
+    void update(double tickTime) override;
+    bool animating() const override;
+    uint32_t bakes() const override {return m_bakes;}
+    const char* name() const override {return m_name;}
+    void setActive(bool active) override;
     
+private:
+    bool needsBake(uint32_t dirty) const;
+    bool drawsWithoutBake(float radius) const;
+    SDFFrameCache::Key cacheKey(float radius) const;
+    bool useRawDistance() const;
+    void allocateTexture(int texSize);
+    void releaseTexture();
+    void releaseBuffers();
+    int8_t* mapNextBuffer(GLsizeiptr bytes);
+    bool bakeTiles(SDFRowKernel rowKernel, int texSize, float radius, int layer);
+    bool bakeGenerated(int texSize, float radius, int layer);
+    void loadMask(uint8_t* mask, int texSize, float radius, bool coverage);
+
+public:
     static constexpr const char* const NAME = "SDF Test";
     static constexpr const int WIDTH = 800;
     static constexpr const int HEIGHT = 800;
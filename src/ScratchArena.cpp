@@ -0,0 +1,32 @@
+#include "ScratchArena.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+void* ScratchArena::reserve(size_t bytes)
+{
+    if (bytes <= m_capacity)
+        return m_data;
+
+    release();
+
+    // NOTE posix_memalign rather than aligned_alloc since we're still on C++14
+    const size_t capacity = align(bytes);
+    if (posix_memalign(&m_data, ALIGNMENT, capacity) != 0)
+    {
+        fprintf(stderr, "Failed to allocate %zu bytes of scratch memory\n", capacity);
+        m_data = nullptr;
+        return nullptr;
+    }
+
+    m_capacity = capacity;
+    ++m_allocations;
+    return m_data;
+}
+
+void ScratchArena::release()
+{
+    free(m_data);
+    m_data = nullptr;
+    m_capacity = 0;
+}
@@ -0,0 +1,41 @@
+#ifndef __SCRATCHARENA_H__
+#define __SCRATCHARENA_H__
+
+#include <cstddef>
+#include <cstdint>
+
+// Grow-only scratch memory that is reused across bakes instead of hitting the heap each time
+class ScratchArena
+{
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+private:
+    void* m_data;
+    size_t m_capacity;
+    uint32_t m_allocations;
+
+public:
+    ScratchArena(): m_data(nullptr), m_capacity(0), m_allocations(0) {}
+    ~ScratchArena() {release();}
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    // Returns ALIGNMENT-aligned memory for at least bytes; contents are not preserved on growth
+    void* reserve(size_t bytes);
+
+    template <typename T>
+    T* get(size_t count) {return static_cast<T*>(reserve(count * sizeof(T)));}
+
+    void release();
+
+    size_t capacity() const {return m_capacity;}
+
+    // Number of times the arena has had to go to the heap
+    uint32_t allocations() const {return m_allocations;}
+
+    static size_t align(size_t bytes) {return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);}
+};
+
+#endif //__SCRATCHARENA_H__
@@ -0,0 +1,64 @@
+#include "Shader.h"
+
+#include <cstdio>
+
+static GLuint loadShader(const char* shaderCode, GLenum shaderType)
+{
+    // Compile the shader file
+    GLuint shader = glCreateShader(shaderType);
+    const char* sourceArray[] = {shaderCode};
+    glShaderSource(shader, 1, sourceArray, NULL);
+    glCompileShader(shader);
+
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+
+    if (success == GL_FALSE)
+    {
+        // Get the length of the error log
+        GLint logLength = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+
+        // Get the error log and print
+        char* errorLog = new char [logLength];
+        glGetShaderInfoLog(shader, logLength, &logLength, errorLog);
+        fprintf(stderr, "%s\n", errorLog);
+        delete[] errorLog;
+
+        // Exit with failure
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+GLuint Shader::loadProgram(const char* vertexShader, const std::string& fragmentShader)
+{
+    GLuint program = glCreateProgram();
+    glAttachShader(program, loadShader(vertexShader, GL_VERTEX_SHADER));
+    glAttachShader(program, loadShader(fragmentShader.c_str(), GL_FRAGMENT_SHADER));
+    glLinkProgram(program);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+    if (success == GL_FALSE)
+    {
+        // Get the length of the error log
+        GLint logLength = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+
+        // Get the error log and print
+        char* errorLog = new char [logLength];
+        glGetProgramInfoLog(program, logLength, &logLength, errorLog);
+        fprintf(stderr, "%s\n", errorLog);
+        delete[] errorLog;
+
+        // Exit with failure
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
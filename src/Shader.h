@@ -0,0 +1,15 @@
+#ifndef __SHADER_H__
+#define __SHADER_H__
+
+#include "GlfwInstance.h"
+
+#include <string>
+
+class Shader
+{
+public:
+    // Compiles and links a program, printing the log and returning 0 if either stage fails
+    static GLuint loadProgram(const char* vertexShader, const std::string& fragmentShader);
+};
+
+#endif //__SHADER_H__
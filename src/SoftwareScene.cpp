@@ -0,0 +1,265 @@
+#include "SoftwareScene.h"
+#include "SDFKernels.h"
+#include "Trace.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Framebuffer rows shaded per task
+static constexpr int BAND_ROWS = 16;
+
+// Band edges and colors of the SDF fragment shader in SDFScene
+static const float BAND_EDGES[6] = {-0.46f, -0.4f, -0.03f, 0.03f, 0.4f, 0.46f};
+static const float BAND_COLORS[6][3] =
+{
+    {1.0f, 0.8f, 0.8f},
+    {0.6f, 0.3f, 0.3f},
+    {0.8f, 0.8f, 1.0f},
+    {0.3f, 0.3f, 0.6f},
+    {0.8f, 1.0f, 0.8f},
+    {0.3f, 0.6f, 0.3f},
+};
+
+// GL_R8_SNORM to float
+struct SnormTable
+{
+    float values[256];
+
+    SnormTable()
+    {
+        for (int i = 0; i < 256; ++i)
+            values[i] = std::max(float(int8_t(i)) / 127.f, -1.f);
+    }
+};
+
+static const float* snormTable()
+{
+    // NOTE a function local static so the first band to get here builds it exactly once
+    static const SnormTable table;
+    return table.values;
+}
+
+static uint8_t toUnorm8(float value)
+{
+    return uint8_t(lrintf(std::min(std::max(value, 0.f), 1.f) * 255.f));
+}
+
+// Same math as the shader, step for step: mask_k = step(edge_k, sample)
+static void shadeSamples(const float* samples, int count, float useSDF, uint8_t* rgb)
+{
+    for (int x = 0; x < count; ++x)
+    {
+        const float sample = samples[x];
+        float mask[7];
+        for (int k = 0; k < 6; ++k)
+            mask[k] = sample >= BAND_EDGES[k] ? 1.f : 0.f;
+        mask[6] = 0.f;
+
+        for (int c = 0; c < 3; ++c)
+        {
+            float shaded = 0.f;
+            for (int k = 0; k < 6; ++k)
+                shaded += BAND_COLORS[k][c] * (mask[k] - mask[k+1]);
+            rgb[x*3+c] = toUnorm8(useSDF * shaded + (1.f - useSDF) * sample);
+        }
+    }
+}
+
+#if defined(__SSE2__)
+static void shadeSamplesSSE2(const float* samples, int count, float useSDF, uint8_t* rgb)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 scale = _mm_set1_ps(255.f);
+    const __m128 shadedWeight = _mm_set1_ps(useSDF);
+    const __m128 unshadedWeight = _mm_set1_ps(1.f - useSDF);
+
+    int x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+        const __m128 sample = _mm_loadu_ps(samples + x);
+        __m128 mask[7];
+        for (int k = 0; k < 6; ++k)
+            mask[k] = _mm_and_ps(_mm_cmpge_ps(sample, _mm_set1_ps(BAND_EDGES[k])), one);
+        mask[6] = zero;
+
+        alignas(16) int32_t channels[3][4];
+        for (int c = 0; c < 3; ++c)
+        {
+            __m128 shaded = zero;
+            for (int k = 0; k < 6; ++k)
+                shaded = _mm_add_ps(shaded, _mm_mul_ps(_mm_set1_ps(BAND_COLORS[k][c]), _mm_sub_ps(mask[k], mask[k+1])));
+            __m128 color = _mm_add_ps(_mm_mul_ps(shadedWeight, shaded), _mm_mul_ps(unshadedWeight, sample));
+            color = _mm_mul_ps(_mm_min_ps(_mm_max_ps(color, zero), one), scale);
+            _mm_store_si128(reinterpret_cast<__m128i*>(channels[c]), _mm_cvtps_epi32(color));
+        }
+
+        for (int i = 0; i < 4; ++i)
+        {
+            rgb[(x+i)*3+0] = uint8_t(channels[0][i]);
+            rgb[(x+i)*3+1] = uint8_t(channels[1][i]);
+            rgb[(x+i)*3+2] = uint8_t(channels[2][i]);
+        }
+    }
+
+    shadeSamples(samples + x, count - x, useSDF, rgb + x*3);
+}
+#endif
+
+void SoftwareScene::bake()
+{
+    const int texSize = 1 << m_texPow;
+    const float radius = m_frameRadius * texSize * 0.01f;
+    if (texSize == m_fieldSize && radius == m_fieldRadius && m_drawCircle == m_fieldCircle)
+        return;
+
+    int8_t* texData = m_field.get<int8_t>(size_t(texSize) * texSize);
+    if (!texData)
+    {
+        m_fieldSize = 0;
+        return;
+    }
+
+    const SDFRowKernel rowKernel = m_drawCircle ? SDFKernels::get().circleRow : SDFKernels::get().boxRow;
+    const int tileRows = SDFKernels::tileRows(texSize);
+    m_pool.parallelFor(texSize / tileRows, [&](int tile)
+    {
+        TRACE_SCOPE("bakeTile");
+        SDFKernels::bakeRows(rowKernel, texSize, radius, &texData[size_t(tile) * tileRows * texSize], tile * tileRows, tileRows);
+    });
+
+    m_fieldSize = texSize;
+    m_fieldRadius = radius;
+    m_fieldCircle = m_drawCircle;
+    ++m_bakes;
+}
+
+void SoftwareScene::prepare(double alpha)
+{
+    // Every radius costs a bake here, so frames between ticks draw the last tick's radius like SDFScene does
+    m_frameRadius = m_radius;
+    bake();
+}
+
+void SoftwareScene::render(double alpha)
+{
+    if (m_fieldSize == 0)
+        return;
+
+    // Like GL, the mag filter only applies when magnifying; SDFScene's min filter is always linear
+    const int texSize = m_fieldSize;
+    const bool linear = m_useBilinear || texSize > m_width || texSize > m_height;
+
+    m_column0.resize(m_width);
+    m_column1.resize(m_width);
+    m_columnWeight.resize(m_width);
+    for (int x = 0; x < m_width; ++x)
+    {
+        const float u = (x + 0.5f) / m_width;
+        if (linear)
+        {
+            const float tx = u * texSize - 0.5f;
+            const int i0 = int(floorf(tx));
+            m_columnWeight[x] = tx - i0;
+            m_column0[x] = std::min(std::max(i0, 0), texSize - 1);
+            m_column1[x] = std::min(std::max(i0 + 1, 0), texSize - 1);
+        }
+        else
+        {
+            m_column0[x] = m_column1[x] = std::min(int(u * texSize), texSize - 1);
+            m_columnWeight[x] = 0.f;
+        }
+    }
+
+    const int bands = (m_height + BAND_ROWS - 1) / BAND_ROWS;
+    m_pool.parallelFor(bands, [&](int band)
+    {
+        TRACE_SCOPE("shadeBand");
+        shadeRows(band * BAND_ROWS, std::min((band + 1) * BAND_ROWS, m_height));
+    });
+}
+
+void SoftwareScene::shadeRows(int y0, int y1)
+{
+    const int texSize = m_fieldSize;
+    const bool linear = m_useBilinear || texSize > m_width || texSize > m_height;
+    const int8_t* texData = m_field.get<int8_t>(0);
+    const float* snorm = snormTable();
+    const float useSDF = m_useSDFShader ? 1.f : 0.f;
+
+    // NOTE rows are sampled and shaded in chunks so the samples fit on the stack
+    static constexpr int CHUNK = 1024;
+    float samples[CHUNK];
+
+    for (int y = y0; y < y1; ++y)
+    {
+        // Rows are stored top first, which is v = 0 after the vertex shader's flip
+        const float v = (y + 0.5f) / m_height;
+        int j0, j1;
+        float wy;
+        if (linear)
+        {
+            const float ty = v * texSize - 0.5f;
+            j0 = int(floorf(ty));
+            wy = ty - j0;
+            j1 = std::min(std::max(j0 + 1, 0), texSize - 1);
+            j0 = std::min(std::max(j0, 0), texSize - 1);
+        }
+        else
+        {
+            j0 = j1 = std::min(int(v * texSize), texSize - 1);
+            wy = 0.f;
+        }
+
+        const uint8_t* row0 = reinterpret_cast<const uint8_t*>(texData + size_t(j0) * texSize);
+        const uint8_t* row1 = reinterpret_cast<const uint8_t*>(texData + size_t(j1) * texSize);
+        for (int x0 = 0; x0 < m_width; x0 += CHUNK)
+        {
+            const int count = std::min(CHUNK, m_width - x0);
+            for (int i = 0; i < count; ++i)
+            {
+                const int c0 = m_column0[x0+i], c1 = m_column1[x0+i];
+                const float wx = m_columnWeight[x0+i];
+                const float top = snorm[row0[c0]] + (snorm[row0[c1]] - snorm[row0[c0]]) * wx;
+                const float bottom = snorm[row1[c0]] + (snorm[row1[c1]] - snorm[row1[c0]]) * wx;
+                samples[i] = top + (bottom - top) * wy;
+            }
+
+            uint8_t* rgb = &m_frame[(size_t(y) * m_width + x0) * 3];
+#if defined(__SSE2__)
+            shadeSamplesSSE2(samples, count, useSDF, rgb);
+#else
+            shadeSamples(samples, count, useSDF, rgb);
+#endif
+        }
+    }
+}
+
+void SoftwareScene::update(double tickTime)
+{
+    // NOTE same animation as SDFScene so the two can be compared frame for frame
+    if (m_radius < 0.8f) m_animScale = 1.01f;
+    else if (m_radius > 4.f) m_animScale = 0.99f;
+    m_radius *= m_animScale;
+}
+
+bool SoftwareScene::writePPM(const char* path) const
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", m_width, m_height);
+    const bool success = fwrite(m_frame.data(), 1, m_frame.size(), file) == m_frame.size();
+    fclose(file);
+    return success;
+}
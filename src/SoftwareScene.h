@@ -0,0 +1,70 @@
+#ifndef __SOFTWARESCENE_H__
+#define __SOFTWARESCENE_H__
+
+#include "GlfwInstance.h"
+#include "ThreadPool.h"
+#include "ScratchArena.h"
+
+#include <cstdint>
+#include <vector>
+
+// Renders the SDF scene entirely on the CPU, for hosts without a GPU and as a reference for the GL path
+// NOTE only the baked texture mode; sampling and shading follow SDFScene's GL state and shader
+class SoftwareScene : public Scene
+{
+private:
+    int m_width, m_height;
+    int32_t m_texPow;
+    float m_radius;
+    bool m_drawCircle;
+    bool m_useBilinear;
+    bool m_useSDFShader;
+    ThreadPool m_pool;
+
+    // Baked field and the parameters it was baked with
+    ScratchArena m_field;
+    int m_fieldSize;
+    float m_fieldRadius;
+    bool m_fieldCircle;
+
+    // Texel columns and weights per framebuffer column; the same for every row
+    std::vector<int> m_column0, m_column1;
+    std::vector<float> m_columnWeight;
+
+    std::vector<uint8_t> m_frame;
+
+    float m_animScale;
+    float m_frameRadius;
+    uint32_t m_bakes;
+
+public:
+    SoftwareScene(int width, int height): m_width(width), m_height(height),
+        m_texPow(5), m_radius(4.f), m_drawCircle(true), m_useBilinear(true), m_useSDFShader(true),
+        m_fieldSize(0), m_fieldRadius(0.f), m_fieldCircle(true), m_frame(width * height * 3),
+        m_animScale(0.99f), m_frameRadius(m_radius), m_bakes(0) {}
+
+    void setTexPow(int32_t texPow) {m_texPow = texPow;}
+    void setRadius(float radius) {m_radius = m_frameRadius = radius;}
+    void setDrawCircle(bool drawCircle) {m_drawCircle = drawCircle;}
+    void setUseBilinear(bool useBilinear) {m_useBilinear = useBilinear;}
+    void setUseSDFShader(bool useSDFShader) {m_useSDFShader = useSDFShader;}
+    void setThreads(int threads) {m_pool.resize(threads);}
+
+    void prepare(double alpha) override;
+    void render(double alpha) override;
+    void update(double tickTime) override;
+    uint32_t bakes() const override {return m_bakes;}
+
+    // Tightly packed RGB8, top row first
+    const uint8_t* frame() const {return m_frame.data();}
+    int width() const {return m_width;}
+    int height() const {return m_height;}
+
+    bool writePPM(const char* path) const;
+
+private:
+    void bake();
+    void shadeRows(int y0, int y1);
+};
+
+#endif //__SOFTWARESCENE_H__
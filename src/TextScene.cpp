@@ -0,0 +1,319 @@
+#include "TextScene.h"
+#include "Shader.h"
+#include "Trace.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+
+static const char* const SAMPLE_LINES[] =
+{
+    u8"The quick brown fox jumps over the lazy dog.",
+    u8"SPHINX OF BLACK QUARTZ, JUDGE MY VOW!",
+    u8"0123456789 +-*/=<>()[]{} @#$%&?",
+    u8"\u00C6r\u00F8sk\u00F8bing fa\u00E7ade, na\u00EFve caf\u00E9 \u2014 \u201Cquoted\u201D \u00BD",
+};
+
+// Sizes each sample line is drawn at, relative to the baked size
+static const float SAMPLE_SCALES[] = {0.5f, 1.f, 2.f};
+
+// Gap between the text and the window edge, in pixels
+static constexpr float MARGIN = 8.f;
+
+// Next code point of a UTF-8 string, or U+FFFD for a malformed sequence
+static uint32_t nextCodepoint(const char*& text)
+{
+    const uint8_t lead = uint8_t(*text++);
+    if (lead < 0x80)
+        return lead;
+
+    const int extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : -1;
+    if (extra < 0)
+        return 0xFFFD;
+    uint32_t codepoint = lead & (0x3F >> extra);
+    for (int i = 0; i < extra; ++i)
+    {
+        // NOTE stops at the terminator, which never matches a continuation byte
+        if ((uint8_t(*text) & 0xC0) != 0x80)
+            return 0xFFFD;
+        codepoint = codepoint << 6 | (uint8_t(*text++) & 0x3F);
+    }
+    return codepoint;
+}
+
+bool TextScene::init()
+{
+    if (!m_font.open(m_fontPath))
+    {
+        fprintf(stderr, "Failed to open font %s\n", m_fontPath);
+        return false;
+    }
+
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_maxTexSize);
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenVertexArrays(1, &m_vao);
+    glBindVertexArray(m_vao);
+
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+    GLint a_position = 0, a_texCoord = 1;
+    glEnableVertexAttribArray(a_position);
+    glVertexAttribPointer(a_position, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, x)));
+    glEnableVertexAttribArray(a_texCoord);
+    glVertexAttribPointer(a_texCoord, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, u)));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Positions are in framebuffer pixels from the top left, so a glyph at scale 1 is drawn at its baked size
+    const char* vertexShader =
+    "#version 410\n"
+    "layout(location = 0) in vec2 a_position;\n"
+    "layout(location = 1) in vec2 a_texCoord;\n"
+    "uniform vec2 u_viewSize;\n"
+    "out vec2 v_texCoord;\n"
+    "void main() {\n"
+    "v_texCoord = a_texCoord;\n"
+    "gl_Position = vec4(a_position / u_viewSize * vec2(2, -2) + vec2(-1, 1), 0.0, 1.0);\n"
+    "}\n";
+
+    // The field is in units of the spread; the texel footprint of a pixel turns it into pixels for the edge ramp
+    const char* fragmentShader =
+    "#version 410\n"
+    "uniform sampler2D u_atlas;\n"
+    "uniform float u_spread;\n"
+    "uniform float u_showField;\n"
+    "in vec2 v_texCoord;\n"
+    "out vec4 f_color;\n"
+    "void main() {\n"
+    "float field = texture(u_atlas, v_texCoord).r;\n"
+    "float texelsPerPixel = length(fwidth(v_texCoord * vec2(textureSize(u_atlas, 0)))) * 0.7071;\n"
+    "float alpha = clamp(field * u_spread / max(texelsPerPixel, 1e-4) + 0.5, 0.0, 1.0);\n"
+    "f_color = mix(vec4(1.0, 1.0, 1.0, alpha), vec4(vec3(0.5 + 0.5 * field), 1.0), u_showField);\n"
+    "}\n";
+
+    m_shader = Shader::loadProgram(vertexShader, fragmentShader);
+    if (!m_shader)
+        return false;
+
+    m_viewSizeLoc = glGetUniformLocation(m_shader, "u_viewSize");
+    m_spreadLoc = glGetUniformLocation(m_shader, "u_spread");
+    m_showFieldLoc = glGetUniformLocation(m_shader, "u_showField");
+    glUseProgram(m_shader);
+    glUniform1i(glGetUniformLocation(m_shader, "u_atlas"), 0);
+    glUseProgram(0);
+
+    // Baked here rather than in preload so a font that can't be baked fails startup
+    if (!bakeAtlas())
+        return false;
+    layout();
+
+    m_tweakBar = TwNewBar(m_name);
+    char barDef[128];
+    snprintf(barDef, sizeof(barDef), " %s size='150 300' color='96 216 224' fontsize=3 ", m_name);
+    TwDefine(barDef);
+    m_pixelSize.init(m_tweakBar, "Pixel Size", " min=4 max=256 step=1 help='Size glyphs are baked at' ",
+        std::bind(&TextScene::markDirty, this, DIRTY_ATLAS));
+    m_spread.init(m_tweakBar, "Spread", " min=1 max=32 help='Pixels the field reaches either side of an outline' ",
+        std::bind(&TextScene::markDirty, this, DIRTY_ATLAS));
+    // NOTE the pool is shared by every scene, so the bar reads its size back rather than keeping a copy
+    char threadsDef[64];
+    snprintf(threadsDef, sizeof(threadsDef), " min=1 max=%d help='Shared by every scene' ", ThreadPool::hardwareThreads());
+    TwAddVarCB(m_tweakBar, "Threads", TW_TYPE_INT32, [](const void* value, void* scene)
+    {
+        TextScene* textScene = static_cast<TextScene*>(scene);
+        textScene->m_pool.resize(*static_cast<const int32_t*>(value));
+        textScene->markDirty(DIRTY_ATLAS);
+    }, [](void* value, void* scene)
+    {
+        *static_cast<int32_t*>(value) = static_cast<TextScene*>(scene)->m_pool.size();
+    }, this, threadsDef);
+    m_textScale.init(m_tweakBar, "Text Scale", " min=0.1 max=16 step=0.1 ", std::bind(&TextScene::markDirty, this, DIRTY_LAYOUT));
+    m_showAtlas.init(m_tweakBar, "Show Atlas", "", std::bind(&TextScene::markDirty, this, DIRTY_LAYOUT));
+    TwAddVarRO(m_tweakBar, "Glyphs", TW_TYPE_UINT32, &m_glyphCount, "");
+    TwAddVarRO(m_tweakBar, "Atlas Width", TW_TYPE_INT32, &m_atlasWidth, "");
+    TwAddVarRO(m_tweakBar, "Atlas Height", TW_TYPE_INT32, &m_atlasHeight, "");
+    TwAddVarRO(m_tweakBar, "Bake ms", TW_TYPE_FLOAT, &m_bakeMs, " precision=3 help='Time to a finished atlas in the last bake' ");
+    TwAddVarRO(m_tweakBar, "Upload ms", TW_TYPE_FLOAT, &m_uploadMs, " precision=3 help='CPU time spent in the last texture upload' ");
+    TwAddVarRO(m_tweakBar, "Bakes", TW_TYPE_UINT32, &m_bakes, " help='Atlases baked since startup' ");
+
+    return true;
+}
+
+void TextScene::close()
+{
+    if (m_tweakBar)
+    {
+        TwDeleteBar(m_tweakBar);
+        m_tweakBar = nullptr;
+    }
+
+    if (m_texture)
+        glDeleteTextures(1, &m_texture);
+    if (m_vbo)
+        glDeleteBuffers(1, &m_vbo);
+    if (m_vao)
+        glDeleteVertexArrays(1, &m_vao);
+    if (m_shader)
+        glDeleteProgram(m_shader);
+    m_texture = 0;
+    m_vbo = 0;
+    m_vao = 0;
+    m_shader = 0;
+
+    m_font.close();
+}
+
+void TextScene::markDirty(uint32_t dirty)
+{
+    m_dirty |= dirty;
+    requestRedraw();
+}
+
+bool TextScene::bakeAtlas()
+{
+    const bool baked = m_atlas.bake(m_font, m_pixelSize.get(), m_spread.get(), m_maxTexSize, m_pool);
+    m_glyphCount = uint32_t(m_atlas.glyphs().size());
+    m_atlasWidth = m_atlas.width();
+    m_atlasHeight = m_atlas.height();
+    m_bakeMs = float(m_atlas.bakeMs());
+    if (!baked)
+    {
+        fprintf(stderr, "Failed to bake %s at %g pixels\n", m_fontPath, m_pixelSize.get());
+        return false;
+    }
+    ++m_bakes;
+
+    TRACE_SCOPE("upload");
+    const double uploadStart = glfwGetTime();
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8_SNORM, m_atlas.width(), m_atlas.height(), 0, GL_RED, GL_BYTE, m_atlas.pixels());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_uploadMs = (glfwGetTime() - uploadStart) * 1000.0;
+    return true;
+}
+
+void TextScene::addText(const char* text, float x, float baseline, float scale)
+{
+    const float invWidth = 1.f / m_atlas.width();
+    const float invHeight = 1.f / m_atlas.height();
+    while (*text)
+    {
+        const FontAtlas::Glyph* glyph = m_atlas.find(nextCodepoint(text));
+        if (!glyph)
+            glyph = m_atlas.find('?');
+        if (!glyph)
+            continue;
+
+        if (glyph->width > 0)
+        {
+            const float x0 = x + glyph->left * scale;
+            const float y0 = baseline - glyph->top * scale;
+            const float x1 = x0 + glyph->width * scale;
+            const float y1 = y0 + glyph->height * scale;
+            const float u0 = glyph->x * invWidth;
+            const float v0 = glyph->y * invHeight;
+            const float u1 = (glyph->x + glyph->width) * invWidth;
+            const float v1 = (glyph->y + glyph->height) * invHeight;
+            m_vertices.push_back({x0, y0, u0, v0});
+            m_vertices.push_back({x1, y0, u1, v0});
+            m_vertices.push_back({x0, y1, u0, v1});
+            m_vertices.push_back({x0, y1, u0, v1});
+            m_vertices.push_back({x1, y0, u1, v0});
+            m_vertices.push_back({x1, y1, u1, v1});
+        }
+        x += glyph->advance * scale;
+    }
+}
+
+void TextScene::layout()
+{
+    m_vertices.clear();
+    const float textScale = m_textScale.get();
+    if (m_showAtlas.get())
+    {
+        // The whole atlas at one texel per pixel times the text scale
+        const float x1 = MARGIN + m_atlas.width() * textScale;
+        const float y1 = MARGIN + m_atlas.height() * textScale;
+        m_vertices.push_back({MARGIN, MARGIN, 0.f, 0.f});
+        m_vertices.push_back({x1, MARGIN, 1.f, 0.f});
+        m_vertices.push_back({MARGIN, y1, 0.f, 1.f});
+        m_vertices.push_back({MARGIN, y1, 0.f, 1.f});
+        m_vertices.push_back({x1, MARGIN, 1.f, 0.f});
+        m_vertices.push_back({x1, y1, 1.f, 1.f});
+    }
+    else if (!m_atlas.glyphs().empty())
+    {
+        // NOTE no kerning; glyphs are placed by their advances alone
+        float top = MARGIN;
+        for (float sampleScale : SAMPLE_SCALES)
+        {
+            const float scale = sampleScale * textScale;
+            for (const char* line : SAMPLE_LINES)
+            {
+                addText(line, MARGIN, top + m_atlas.ascent() * scale, scale);
+                top += m_atlas.lineHeight() * scale;
+            }
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), m_vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_vertexCount = GLsizei(m_vertices.size());
+}
+
+void TextScene::prepare(double alpha)
+{
+    // A failed bake leaves an empty atlas, which lays out as nothing
+    if (m_dirty & DIRTY_ATLAS)
+        bakeAtlas();
+    if (m_dirty)
+        layout();
+    m_dirty = 0;
+}
+
+void TextScene::render(double alpha)
+{
+    if (m_vertexCount == 0)
+        return;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glUseProgram(m_shader);
+    glUniform2f(m_viewSizeLoc, float(viewport[2]), float(viewport[3]));
+    glUniform1f(m_spreadLoc, float(m_atlas.spread()));
+    glUniform1f(m_showFieldLoc, m_showAtlas.get() ? 1.f : 0.f);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, m_vertexCount);
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
+
+void TextScene::setActive(bool active)
+{
+    if (!m_tweakBar)
+        return;
+
+    char barDef[64];
+    snprintf(barDef, sizeof(barDef), " %s visible=%s ", m_name, active ? "true" : "false");
+    TwDefine(barDef);
+}
@@ -0,0 +1,83 @@
+#ifndef __TEXTSCENE_H__
+#define __TEXTSCENE_H__
+
+#include "GlfwInstance.h"
+#include "TwWrapper.h"
+#include "ThreadPool.h"
+#include "TrueType.h"
+#include "FontAtlas.h"
+
+#include <cstdint>
+#include <vector>
+
+// Lines of sample text drawn at several sizes from one baked glyph atlas
+// Every glyph the font maps is baked, so changing the bake settings shows the time to a full atlas.
+class TextScene : public Scene
+{
+private:
+    // Dirty flags; a rebake always needs a new layout too
+    enum DirtyFlags : uint32_t
+    {
+        DIRTY_LAYOUT = 1 << 0,
+        DIRTY_ATLAS = 1 << 1,
+    };
+
+    struct Vertex
+    {
+        float x, y, u, v;
+    };
+
+    const char* m_name;
+    const char* m_fontPath;
+    TwBar* m_tweakBar;
+    TrueTypeFont m_font;
+    FontAtlas m_atlas;
+    GLuint m_texture;
+    GLint m_maxTexSize;
+    GLuint m_shader;
+    GLint m_viewSizeLoc, m_spreadLoc, m_showFieldLoc;
+    GLuint m_vao, m_vbo;
+    GLsizei m_vertexCount;
+    std::vector<Vertex> m_vertices;
+    TwWrapper<float> m_pixelSize;
+    TwWrapper<int32_t> m_spread;
+    TwWrapper<float> m_textScale;
+    TwWrapper<bool> m_showAtlas;
+    ThreadPool& m_pool;
+    uint32_t m_glyphCount;
+    int32_t m_atlasWidth, m_atlasHeight;
+    float m_bakeMs;
+    float m_uploadMs;
+    uint32_t m_bakes;
+    uint32_t m_dirty;
+
+public:
+    // NOTE the name is also the tweak bar's, so it must be unique and can't contain spaces; the path isn't copied,
+    // and the pool is shared with the other scenes and must outlive this one
+    TextScene(const char* name, const char* fontPath, ThreadPool& pool): m_name(name), m_fontPath(fontPath), m_tweakBar(nullptr), m_texture(0),
+        m_maxTexSize(0), m_shader(0), m_viewSizeLoc(-1), m_spreadLoc(-1), m_showFieldLoc(-1), m_vao(0), m_vbo(0), m_vertexCount(0),
+        m_pixelSize(32.f), m_spread(4), m_textScale(1.f), m_showAtlas(false), m_pool(pool),
+        m_glyphCount(0), m_atlasWidth(0), m_atlasHeight(0), m_bakeMs(0.f), m_uploadMs(0.f), m_bakes(0),
+        m_dirty(0) {}
+    ~TextScene() {close();}
+
+    // Opens the font and bakes the first atlas
+    bool init() override;
+    void close() override;
+
+    void prepare(double alpha) override;
+    void render(double alpha) override;
+    void update(double tickTime) override {}
+    bool animating() const override {return m_dirty != 0;}
+    uint32_t bakes() const override {return m_bakes;}
+    const char* name() const override {return m_name;}
+    void setActive(bool active) override;
+
+private:
+    void markDirty(uint32_t dirty);
+    bool bakeAtlas();
+    void layout();
+    void addText(const char* text, float x, float baseline, float scale);
+};
+
+#endif //__TEXTSCENE_H__
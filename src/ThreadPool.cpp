@@ -0,0 +1,101 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads): m_task(nullptr), m_invoke(nullptr), m_next(0), m_count(0), m_busy(0),
+    m_generation(0), m_quit(false)
+{
+    resize(threads);
+}
+
+void ThreadPool::resize(int threads)
+{
+    threads = std::max(threads, 1);
+    if (threads == size())
+        return;
+
+    stop();
+
+    m_quit = false;
+    m_workers.reserve(threads - 1);
+    for (int i = 1; i < threads; ++i)
+        m_workers.emplace_back(&ThreadPool::workerLoop, this, m_generation);
+}
+
+void ThreadPool::run(int count, const void* task, Invoke invoke)
+{
+    // Not worth waking anyone for a single task
+    if (m_workers.empty() || count <= 1)
+    {
+        for (int i = 0; i < count; ++i)
+            invoke(task, i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = task;
+        m_invoke = invoke;
+        m_count = count;
+        m_next = 0;
+        m_busy = int(m_workers.size());
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    runTasks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] {return m_busy == 0;});
+    m_task = nullptr;
+    m_invoke = nullptr;
+}
+
+int ThreadPool::hardwareThreads()
+{
+    // NOTE hardware_concurrency is allowed to return 0 if it can't tell
+    return std::max(int(std::thread::hardware_concurrency()), 1);
+}
+
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+}
+
+void ThreadPool::runTasks()
+{
+    for (int i = m_next++; i < m_count; i = m_next++)
+        m_invoke(m_task, i);
+}
+
+void ThreadPool::workerLoop(uint64_t generation)
+{
+    // NOTE generation is passed in rather than read here so a job posted before the thread
+    // gets scheduled still counts this worker
+    Trace::setThreadName("Worker");
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] {return m_quit || m_generation != generation;});
+            if (m_quit)
+                return;
+            generation = m_generation;
+        }
+
+        runTasks();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy == 0)
+            m_done.notify_one();
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Long-lived workers that split an indexed job with the calling thread
+class ThreadPool
+{
+    typedef void (*Invoke)(const void* task, int index);
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const void* m_task;
+    Invoke m_invoke;
+    std::atomic<int> m_next;
+    int m_count;
+    int m_busy;
+    uint64_t m_generation;
+    bool m_quit;
+
+public:
+    explicit ThreadPool(int threads = hardwareThreads());
+    ~ThreadPool() {stop();}
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Thread count includes the calling thread; must not be called during parallelFor
+    void resize(int threads);
+    int size() const {return int(m_workers.size()) + 1;}
+
+    // Runs task(i) for i in [0, count) and blocks until all are done
+    // NOTE templated rather than std::function so a bake doesn't allocate for its captures
+    template <typename Task>
+    void parallelFor(int count, const Task& task)
+    {
+        run(count, &task, [](const void* ptr, int index) {(*static_cast<const Task*>(ptr))(index);});
+    }
+
+    static int hardwareThreads();
+
+private:
+    void run(int count, const void* task, Invoke invoke);
+    void stop();
+    void runTasks();
+    void workerLoop(uint64_t generation);
+};
+
+#endif //__THREADPOOL_H__
@@ -0,0 +1,159 @@
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct TraceSpan
+{
+    const char* name;
+    int64_t begin, end;
+};
+
+static_assert((Trace::CAPACITY & (Trace::CAPACITY - 1)) == 0, "the ring is indexed with a mask");
+
+// Written only by its own thread; count is published after the span so a dump never sees a partial one
+struct TraceBuffer
+{
+    int index;
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> count; // spans ever recorded; the ring holds the last CAPACITY of them
+    TraceSpan spans[Trace::CAPACITY];
+};
+
+static std::mutex s_registryMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> s_buffers;
+static int s_nextIndex = 1;
+static std::atomic<bool> s_enabled(true);
+static const int64_t s_epoch = Trace::now();
+static thread_local TraceBuffer* t_buffer = nullptr;
+static thread_local const char* t_name = nullptr;
+
+// Unregisters and frees the thread's buffer when the thread exits, so resizing a pool doesn't leak them
+// NOTE thread_local destructors run before statics are destroyed, even for the main thread
+struct TraceBufferOwner
+{
+    TraceBuffer* buffer = nullptr;
+
+    ~TraceBufferOwner()
+    {
+        if (!buffer)
+            return;
+
+        t_buffer = nullptr;
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        for (auto it = s_buffers.begin(); it != s_buffers.end(); ++it)
+        {
+            if (it->get() == buffer)
+            {
+                s_buffers.erase(it);
+                break;
+            }
+        }
+    }
+};
+
+static thread_local TraceBufferOwner t_owner;
+
+static TraceBuffer* threadBuffer()
+{
+    if (!t_buffer)
+    {
+        std::unique_ptr<TraceBuffer> buffer(new TraceBuffer);
+        buffer->name = t_name;
+        buffer->count = 0;
+        t_buffer = buffer.get();
+        t_owner.buffer = t_buffer;
+
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        buffer->index = s_nextIndex++;
+        s_buffers.push_back(std::move(buffer));
+    }
+    return t_buffer;
+}
+
+void Trace::record(const char* name, int64_t begin, int64_t end)
+{
+    if (!s_enabled.load(std::memory_order_relaxed))
+        return;
+
+    TraceBuffer* buffer = threadBuffer();
+    const uint64_t count = buffer->count.load(std::memory_order_relaxed);
+    buffer->spans[count & (CAPACITY - 1)] = {name, begin, end};
+    buffer->count.store(count + 1, std::memory_order_release);
+}
+
+void Trace::setThreadName(const char* name)
+{
+    // NOTE doesn't create the buffer, so threads that never record cost nothing
+    t_name = name;
+    if (t_buffer)
+        t_buffer->name.store(name, std::memory_order_relaxed);
+}
+
+bool Trace::dump(const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    bool first = true;
+    size_t spans = 0, overwritten = 0;
+    for (const auto& buffer : s_buffers)
+    {
+        const char* name = buffer->name.load(std::memory_order_relaxed);
+        char fallback[32];
+        if (!name)
+        {
+            snprintf(fallback, sizeof(fallback), "Thread %d", buffer->index);
+            name = fallback;
+        }
+        fprintf(file, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+            first ? "" : ",", buffer->index, name);
+        first = false;
+
+        // Timestamps are microseconds since startup; the ring is written out oldest first
+        const uint64_t count = buffer->count.load(std::memory_order_acquire);
+        const uint64_t oldest = count > uint64_t(CAPACITY) ? count - CAPACITY : 0;
+        for (uint64_t i = oldest; i < count; ++i)
+        {
+            const TraceSpan& span = buffer->spans[i & (CAPACITY - 1)];
+            fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                span.name, buffer->index, (span.begin - s_epoch) * 1e-3, (span.end - span.begin) * 1e-3);
+        }
+        spans += size_t(count - oldest);
+        overwritten += size_t(oldest);
+    }
+
+    fprintf(file, "\n]}\n");
+    const bool success = ferror(file) == 0;
+    fclose(file);
+
+    if (success)
+        printf("Wrote %zu trace spans to %s (%zu older ones overwritten)\n", spans, path, overwritten);
+    return success;
+}
+
+void Trace::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Trace::enabled()
+{
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+int64_t Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
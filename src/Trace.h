@@ -0,0 +1,50 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <cstdint>
+
+// Timeline spans for chrome://tracing or Perfetto
+// Each thread records into its own ring, so recording never takes a lock; only a thread's first span
+// registers its buffer. A full ring overwrites its oldest spans, so a dump always shows the latest
+// stretch of the run. A thread's buffer, and with it its spans, is freed when the thread exits.
+class Trace
+{
+public:
+    // Spans kept per thread, a power of two; 64K spans is a couple of minutes of bakes at 8 threads
+    static constexpr int CAPACITY = 64 * 1024;
+
+    class Scope
+    {
+    private:
+        const char* m_name;
+        int64_t m_begin;
+
+    public:
+        // NOTE name must outlive the trace; use string literals
+        explicit Scope(const char* name): m_name(name), m_begin(now()) {}
+        ~Scope() {record(m_name, m_begin, now());}
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    static void record(const char* name, int64_t begin, int64_t end);
+
+    // Names the calling thread in the dump; unnamed threads show up by their index
+    static void setThreadName(const char* name);
+
+    // Writes every thread's spans as Chrome trace JSON; call while the worker pool is idle
+    static bool dump(const char* path);
+
+    static void setEnabled(bool enabled);
+    static bool enabled();
+
+    // Nanoseconds on the steady clock
+    static int64_t now();
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif //__TRACE_H__
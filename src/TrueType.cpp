@@ -0,0 +1,652 @@
+#include "TrueType.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Deepest a composite glyph may nest other composites
+static constexpr int MAX_COMPOSITE_DEPTH = 8;
+
+// Simple glyph flags
+static constexpr uint8_t ON_CURVE = 1 << 0;
+static constexpr uint8_t X_SHORT = 1 << 1;
+static constexpr uint8_t Y_SHORT = 1 << 2;
+static constexpr uint8_t REPEAT = 1 << 3;
+static constexpr uint8_t X_SAME_OR_POSITIVE = 1 << 4;
+static constexpr uint8_t Y_SAME_OR_POSITIVE = 1 << 5;
+
+// Composite glyph flags
+static constexpr uint16_t ARGS_ARE_WORDS = 1 << 0;
+static constexpr uint16_t ARGS_ARE_XY = 1 << 1;
+static constexpr uint16_t HAVE_SCALE = 1 << 3;
+static constexpr uint16_t MORE_COMPONENTS = 1 << 5;
+static constexpr uint16_t HAVE_XY_SCALE = 1 << 6;
+static constexpr uint16_t HAVE_TWO_BY_TWO = 1 << 7;
+
+static uint16_t readU16(const uint8_t* p) {return uint16_t(p[0] << 8 | p[1]);}
+static int16_t readI16(const uint8_t* p) {return int16_t(readU16(p));}
+static uint32_t readU32(const uint8_t* p) {return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];}
+static float readF2Dot14(const uint8_t* p) {return readI16(p) * (1.f / 16384.f);}
+
+static bool findTable(const uint8_t* data, size_t size, const char* tag, uint32_t& offset, uint32_t& length)
+{
+    const int tables = readU16(data + 4);
+    if (12 + size_t(tables) * 16 > size)
+        return false;
+    for (int i = 0; i < tables; ++i)
+    {
+        const uint8_t* record = data + 12 + i * 16;
+        if (memcmp(record, tag, 4) != 0)
+            continue;
+        offset = readU32(record + 8);
+        length = readU32(record + 12);
+        return size_t(offset) + length <= size;
+    }
+    return false;
+}
+
+namespace
+{
+    struct Point
+    {
+        float x, y;
+    };
+
+    // Turns a contour's quadratic curves into lines, in bitmap space
+    class Flattener
+    {
+        std::vector<TrueTypeFont::Line>& m_lines;
+        Point m_current;
+
+    public:
+        explicit Flattener(std::vector<TrueTypeFont::Line>& lines): m_lines(lines), m_current{0.f, 0.f} {}
+
+        void moveTo(Point p) {m_current = p;}
+
+        void lineTo(Point p)
+        {
+            m_lines.push_back({m_current.x, m_current.y, p.x, p.y});
+            m_current = p;
+        }
+
+        void quadTo(Point control, Point p)
+        {
+            // Segments grow with the square root of the curve's deviation, so the error stays under a tenth of a pixel
+            const Point p0 = m_current;
+            const float ddx = p0.x - 2.f * control.x + p.x;
+            const float ddy = p0.y - 2.f * control.y + p.y;
+            const float deviation2 = ddx * ddx + ddy * ddy;
+            if (deviation2 < 0.333f)
+            {
+                lineTo(p);
+                return;
+            }
+
+            const int segments = 1 + int(sqrtf(sqrtf(3.f * deviation2)));
+            for (int i = 1; i < segments; ++i)
+            {
+                const float t = float(i) / segments;
+                const float s = 1.f - t;
+                lineTo({s * s * p0.x + 2.f * s * t * control.x + t * t * p.x, s * s * p0.y + 2.f * s * t * control.y + t * t * p.y});
+            }
+            lineTo(p);
+        }
+    };
+}
+
+bool TrueTypeFont::open(const char* path)
+{
+    close();
+
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < 12)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // NOTE the mapping outlives the descriptor
+    void* data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = size_t(info.st_size);
+
+    // Version 1.0 or Apple's 'true'
+    const uint32_t version = readU32(m_data);
+    uint32_t head, headSize, maxp, maxpSize, hhea, hheaSize, hmtxSize, locaSize, cmap, cmapSize;
+    if ((version != 0x00010000 && version != 0x74727565)
+        || !findTable(m_data, m_size, "head", head, headSize) || headSize < 54
+        || !findTable(m_data, m_size, "maxp", maxp, maxpSize) || maxpSize < 6
+        || !findTable(m_data, m_size, "hhea", hhea, hheaSize) || hheaSize < 36
+        || !findTable(m_data, m_size, "hmtx", m_hmtx, hmtxSize)
+        || !findTable(m_data, m_size, "loca", m_loca, locaSize)
+        || !findTable(m_data, m_size, "glyf", m_glyf, m_glyfSize)
+        || !findTable(m_data, m_size, "cmap", cmap, cmapSize) || cmapSize < 4)
+    {
+        close();
+        return false;
+    }
+
+    m_unitsPerEm = readU16(m_data + head + 18);
+    m_longLoca = readI16(m_data + head + 50) != 0;
+    m_glyphCount = readU16(m_data + maxp + 4);
+    m_ascent = readI16(m_data + hhea + 4);
+    m_descent = readI16(m_data + hhea + 6);
+    m_lineGap = readI16(m_data + hhea + 8);
+    m_hMetricCount = readU16(m_data + hhea + 34);
+
+    const uint32_t locaEntries = locaSize / (m_longLoca ? 4 : 2);
+    if (m_unitsPerEm == 0 || m_hMetricCount == 0 || m_hMetricCount > m_glyphCount || locaEntries < uint32_t(m_glyphCount) + 1
+        || size_t(m_hMetricCount) * 4 + size_t(m_glyphCount - m_hMetricCount) * 2 > hmtxSize)
+    {
+        close();
+        return false;
+    }
+
+    // Prefer a full Unicode map, then the basic plane
+    int best = 0;
+    const int subtables = readU16(m_data + cmap + 2);
+    for (int i = 0; i < subtables && 4 + size_t(i + 1) * 8 <= cmapSize; ++i)
+    {
+        const uint8_t* record = m_data + cmap + 4 + i * 8;
+        const int platform = readU16(record);
+        const int encoding = readU16(record + 2);
+        const uint32_t offset = readU32(record + 4);
+        if ((platform != 0 && platform != 3) || (platform == 3 && encoding != 1 && encoding != 10) || offset + 8 > cmapSize)
+            continue;
+
+        const int format = readU16(m_data + cmap + offset);
+        const int rank = format == 12 ? 2 : format == 4 ? 1 : 0;
+        if (rank > best)
+        {
+            best = rank;
+            m_cmap = cmap + offset;
+            m_cmapFormat = format;
+        }
+    }
+
+    // Subtable lengths are checked here so lookups don't have to
+    bool valid = best > 0;
+    if (m_cmapFormat == 4)
+    {
+        const uint32_t segments = readU16(m_data + m_cmap + 6) / 2;
+        valid = valid && size_t(m_cmap) + 16 + segments * 8 <= size_t(cmap) + cmapSize;
+    }
+    else if (m_cmapFormat == 12)
+    {
+        valid = valid && size_t(m_cmap) + 16 <= size_t(cmap) + cmapSize;
+        valid = valid && size_t(m_cmap) + 16 + size_t(readU32(m_data + m_cmap + 12)) * 12 <= size_t(cmap) + cmapSize;
+    }
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void TrueTypeFont::close()
+{
+    if (m_data)
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+    m_cmapFormat = 0;
+    m_glyphCount = 0;
+}
+
+int TrueTypeFont::glyphIndex(uint32_t codepoint) const
+{
+    int glyph = 0;
+    if (m_cmapFormat == 4)
+    {
+        if (codepoint > 0xFFFF)
+            return 0;
+
+        // Segments are sorted by their last code point
+        const int segments = readU16(m_data + m_cmap + 6) / 2;
+        const uint8_t* ends = m_data + m_cmap + 14;
+        const uint8_t* starts = ends + segments * 2 + 2;
+        const uint8_t* deltas = starts + segments * 2;
+        const uint8_t* rangeOffsets = deltas + segments * 2;
+        int lo = 0, hi = segments;
+        while (lo < hi)
+        {
+            const int mid = (lo + hi) / 2;
+            if (readU16(ends + mid * 2) < codepoint)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo == segments || readU16(starts + lo * 2) > codepoint)
+            return 0;
+
+        const int delta = readU16(deltas + lo * 2);
+        const int rangeOffset = readU16(rangeOffsets + lo * 2);
+        if (rangeOffset == 0)
+            glyph = (codepoint + delta) & 0xFFFF;
+        else
+        {
+            // NOTE the offset is relative to where it's stored
+            const size_t address = size_t(rangeOffsets + lo * 2 - m_data) + rangeOffset + (codepoint - readU16(starts + lo * 2)) * 2;
+            if (address + 2 > m_size)
+                return 0;
+            glyph = readU16(m_data + address);
+            if (glyph != 0)
+                glyph = (glyph + delta) & 0xFFFF;
+        }
+    }
+    else if (m_cmapFormat == 12)
+    {
+        const uint32_t groups = readU32(m_data + m_cmap + 12);
+        const uint8_t* group = m_data + m_cmap + 16;
+        uint32_t lo = 0, hi = groups;
+        while (lo < hi)
+        {
+            const uint32_t mid = (lo + hi) / 2;
+            if (readU32(group + mid * 12 + 4) < codepoint)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo == groups || readU32(group + lo * 12) > codepoint)
+            return 0;
+        glyph = int(readU32(group + lo * 12 + 8) + (codepoint - readU32(group + lo * 12)));
+    }
+
+    return glyph < m_glyphCount ? glyph : 0;
+}
+
+void TrueTypeFont::codepoints(std::vector<uint32_t>& dst) const
+{
+    dst.clear();
+    if (m_cmapFormat == 4)
+    {
+        const int segments = readU16(m_data + m_cmap + 6) / 2;
+        const uint8_t* ends = m_data + m_cmap + 14;
+        const uint8_t* starts = ends + segments * 2 + 2;
+        for (int i = 0; i < segments; ++i)
+        {
+            // NOTE the last segment just maps 0xFFFF to the missing glyph
+            const uint32_t end = std::min<uint32_t>(readU16(ends + i * 2), 0xFFFE);
+            for (uint32_t codepoint = readU16(starts + i * 2); codepoint <= end; ++codepoint)
+            {
+                if (glyphIndex(codepoint) != 0)
+                    dst.push_back(codepoint);
+            }
+        }
+    }
+    else if (m_cmapFormat == 12)
+    {
+        const uint32_t groups = readU32(m_data + m_cmap + 12);
+        const uint8_t* group = m_data + m_cmap + 16;
+        for (uint32_t i = 0; i < groups; ++i)
+        {
+            // A bogus group could claim billions of code points, but never more than there are glyphs
+            const uint32_t start = readU32(group + i * 12);
+            const uint32_t end = std::min(readU32(group + i * 12 + 4), start + uint32_t(m_glyphCount));
+            for (uint32_t codepoint = start; codepoint <= end && codepoint <= 0x10FFFF; ++codepoint)
+            {
+                if (glyphIndex(codepoint) != 0)
+                    dst.push_back(codepoint);
+            }
+        }
+    }
+
+    // Segments should already be sorted, but nothing checks that
+    std::sort(dst.begin(), dst.end());
+    dst.erase(std::unique(dst.begin(), dst.end()), dst.end());
+}
+
+void TrueTypeFont::horizontalMetrics(int glyph, int& advance, int& leftBearing) const
+{
+    // Glyphs past the last full entry share its advance and only store a bearing
+    const uint8_t* hmtx = m_data + m_hmtx;
+    if (glyph < m_hMetricCount)
+    {
+        advance = readU16(hmtx + glyph * 4);
+        leftBearing = readI16(hmtx + glyph * 4 + 2);
+        return;
+    }
+    advance = readU16(hmtx + (m_hMetricCount - 1) * 4);
+    leftBearing = readI16(hmtx + m_hMetricCount * 4 + (glyph - m_hMetricCount) * 2);
+}
+
+bool TrueTypeFont::glyphData(int glyph, uint32_t& offset, uint32_t& size) const
+{
+    if (glyph < 0 || glyph >= m_glyphCount)
+        return false;
+
+    uint32_t start, end;
+    if (m_longLoca)
+    {
+        start = readU32(m_data + m_loca + glyph * 4);
+        end = readU32(m_data + m_loca + glyph * 4 + 4);
+    }
+    else
+    {
+        start = readU16(m_data + m_loca + glyph * 2) * 2u;
+        end = readU16(m_data + m_loca + glyph * 2 + 2) * 2u;
+    }
+
+    // An empty glyph has no data at all, not even a header
+    if (end <= start || end > m_glyfSize || end - start < 10)
+        return false;
+    offset = m_glyf + start;
+    size = end - start;
+    return true;
+}
+
+bool TrueTypeFont::glyphBox(int glyph, Box& box) const
+{
+    uint32_t offset, size;
+    if (!glyphData(glyph, offset, size))
+        return false;
+
+    const uint8_t* header = m_data + offset;
+    box.xMin = readI16(header + 2);
+    box.yMin = readI16(header + 4);
+    box.xMax = readI16(header + 6);
+    box.yMax = readI16(header + 8);
+    return box.xMax > box.xMin && box.yMax > box.yMin;
+}
+
+bool TrueTypeFont::outline(int glyph, float scale, float dx, float dy, std::vector<Line>& lines) const
+{
+    // Affine map as x' = a x + c y + e, y' = b x + d y + f
+    const float transform[6] = {scale, 0.f, 0.f, -scale, dx, dy};
+    return appendOutline(glyph, transform, 0, lines);
+}
+
+bool TrueTypeFont::appendOutline(int glyph, const float* transform, int depth, std::vector<Line>& lines) const
+{
+    uint32_t offset, size;
+    if (!glyphData(glyph, offset, size))
+        return true;
+
+    const int contours = readI16(m_data + offset);
+    if (contours >= 0)
+        return appendSimple(offset, size, contours, transform, lines);
+    return depth < MAX_COMPOSITE_DEPTH && appendComposite(offset, size, transform, depth, lines);
+}
+
+bool TrueTypeFont::appendSimple(uint32_t offset, uint32_t size, int contours, const float* transform, std::vector<Line>& lines) const
+{
+    const uint8_t* p = m_data + offset + 10;
+    const uint8_t* end = m_data + offset + size;
+    if (contours == 0)
+        return true;
+    if (p + contours * 2 + 2 > end)
+        return false;
+
+    const uint8_t* contourEnds = p;
+    const int points = readU16(contourEnds + (contours - 1) * 2) + 1;
+    p += contours * 2;
+    p += 2 + readU16(p); // skip the instructions
+    if (p > end)
+        return false;
+
+    // Flags are run length encoded, then come all the x deltas and all the y deltas
+    std::vector<uint8_t> flags(points);
+    for (int i = 0; i < points;)
+    {
+        if (p >= end)
+            return false;
+        const uint8_t flag = *p++;
+        int repeat = 1;
+        if (flag & REPEAT)
+        {
+            if (p >= end)
+                return false;
+            repeat += *p++;
+        }
+        for (; repeat > 0 && i < points; --repeat)
+            flags[i++] = flag;
+    }
+
+    std::vector<Point> coords(points);
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        const uint8_t shortFlag = axis == 0 ? X_SHORT : Y_SHORT;
+        const uint8_t sameFlag = axis == 0 ? X_SAME_OR_POSITIVE : Y_SAME_OR_POSITIVE;
+        int value = 0;
+        for (int i = 0; i < points; ++i)
+        {
+            if (flags[i] & shortFlag)
+            {
+                if (p >= end)
+                    return false;
+                value += (flags[i] & sameFlag) ? *p : -*p;
+                ++p;
+            }
+            else if (!(flags[i] & sameFlag))
+            {
+                if (p + 2 > end)
+                    return false;
+                value += readI16(p);
+                p += 2;
+            }
+            (axis == 0 ? coords[i].x : coords[i].y) = float(value);
+        }
+    }
+
+    for (Point& point : coords)
+    {
+        const Point font = point;
+        point.x = transform[0] * font.x + transform[2] * font.y + transform[4];
+        point.y = transform[1] * font.x + transform[3] * font.y + transform[5];
+    }
+
+    Flattener flattener(lines);
+    int first = 0;
+    for (int contour = 0; contour < contours; ++contour)
+    {
+        const int last = readU16(contourEnds + contour * 2);
+        if (last < first || last >= points)
+            return false;
+        const int count = last - first + 1;
+        const Point* pts = &coords[first];
+        const uint8_t* on = &flags[first];
+        first = last + 1;
+        if (count < 2)
+            continue;
+
+        // Start on a point that's on the curve, or between two control points if there isn't one
+        Point start;
+        int from = 0, to = count;
+        if (on[0] & ON_CURVE)
+        {
+            start = pts[0];
+            from = 1;
+        }
+        else if (on[count - 1] & ON_CURVE)
+        {
+            start = pts[count - 1];
+            to = count - 1;
+        }
+        else
+            start = {0.5f * (pts[0].x + pts[count - 1].x), 0.5f * (pts[0].y + pts[count - 1].y)};
+
+        // Two control points in a row imply an on curve point halfway between them
+        flattener.moveTo(start);
+        bool haveControl = false;
+        Point control = start;
+        for (int i = from; i <= to; ++i)
+        {
+            const bool closing = i == to;
+            const Point point = closing ? start : pts[i];
+            if (closing || (on[i] & ON_CURVE))
+            {
+                if (haveControl)
+                    flattener.quadTo(control, point);
+                else
+                    flattener.lineTo(point);
+                haveControl = false;
+            }
+            else
+            {
+                if (haveControl)
+                    flattener.quadTo(control, {0.5f * (control.x + point.x), 0.5f * (control.y + point.y)});
+                control = point;
+                haveControl = true;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool TrueTypeFont::appendComposite(uint32_t offset, uint32_t size, const float* transform, int depth, std::vector<Line>& lines) const
+{
+    const uint8_t* p = m_data + offset + 10;
+    const uint8_t* end = m_data + offset + size;
+    uint16_t flags = MORE_COMPONENTS;
+    while (flags & MORE_COMPONENTS)
+    {
+        if (p + 4 > end)
+            return false;
+        flags = readU16(p);
+        const int glyph = readU16(p + 2);
+        p += 4;
+
+        const int argSize = (flags & ARGS_ARE_WORDS) ? 2 : 1;
+        const int scaleSize = (flags & HAVE_TWO_BY_TWO) ? 8 : (flags & HAVE_XY_SCALE) ? 4 : (flags & HAVE_SCALE) ? 2 : 0;
+        if (p + 2 * argSize + scaleSize > end)
+            return false;
+
+        // NOTE components placed by matching points are rare enough to just leave where they are
+        float offsetX = 0.f, offsetY = 0.f;
+        if (flags & ARGS_ARE_XY)
+        {
+            offsetX = argSize == 2 ? readI16(p) : int8_t(p[0]);
+            offsetY = argSize == 2 ? readI16(p + 2) : int8_t(p[1]);
+        }
+        p += 2 * argSize;
+
+        float a = 1.f, b = 0.f, c = 0.f, d = 1.f;
+        if (flags & HAVE_TWO_BY_TWO)
+        {
+            a = readF2Dot14(p);
+            b = readF2Dot14(p + 2);
+            c = readF2Dot14(p + 4);
+            d = readF2Dot14(p + 6);
+        }
+        else if (flags & HAVE_XY_SCALE)
+        {
+            a = readF2Dot14(p);
+            d = readF2Dot14(p + 2);
+        }
+        else if (flags & HAVE_SCALE)
+            a = d = readF2Dot14(p);
+        p += scaleSize;
+
+        // The component's own transform applies first
+        const float combined[6] =
+        {
+            transform[0] * a + transform[2] * b,
+            transform[1] * a + transform[3] * b,
+            transform[0] * c + transform[2] * d,
+            transform[1] * c + transform[3] * d,
+            transform[0] * offsetX + transform[2] * offsetY + transform[4],
+            transform[1] * offsetX + transform[3] * offsetY + transform[5],
+        };
+        if (!appendOutline(glyph, combined, depth + 1, lines))
+            return false;
+    }
+    return true;
+}
+
+void TrueTypeFont::rasterize(const std::vector<Line>& lines, int width, int height, float* accumulation, uint8_t* dst)
+{
+    // Each line adds the signed area it sweeps to the pixels it crosses and takes it back from the pixel to their
+    // right, so a running sum across every row gives the winding-weighted coverage
+    const size_t texels = size_t(width) * height;
+    std::fill(accumulation, accumulation + texels + 2, 0.f);
+
+    const float maxX = width - 1.f / 256.f;
+    for (const Line& line : lines)
+    {
+        float x0 = std::min(std::max(line.x0, 0.f), maxX);
+        float y0 = std::min(std::max(line.y0, 0.f), float(height));
+        float x1 = std::min(std::max(line.x1, 0.f), maxX);
+        float y1 = std::min(std::max(line.y1, 0.f), float(height));
+        if (y0 == y1)
+            continue;
+
+        float dir = 1.f;
+        if (y0 > y1)
+        {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+            dir = -1.f;
+        }
+
+        const float dxdy = (x1 - x0) / (y1 - y0);
+        float x = x0;
+        const int yEnd = std::min(height, int(ceilf(y1)));
+        for (int y = int(y0); y < yEnd; ++y)
+        {
+            float* row = accumulation + size_t(y) * width;
+            const float dy = std::min(float(y + 1), y1) - std::max(float(y), y0);
+            const float xNext = x + dxdy * dy;
+            const float d = dy * dir;
+            const float left = std::min(x, xNext);
+            const float right = std::max(x, xNext);
+            const float leftFloor = floorf(left);
+            const int leftIndex = int(leftFloor);
+            const float rightCeil = ceilf(right);
+            const int rightIndex = int(rightCeil);
+
+            if (rightIndex <= leftIndex + 1)
+            {
+                // Within one pixel, split by where the line crosses it on average
+                const float mid = 0.5f * (x + xNext) - leftFloor;
+                row[leftIndex] += d - d * mid;
+                row[leftIndex + 1] += d * mid;
+            }
+            else
+            {
+                // Across several, a triangle in the first and last and an even share in between
+                const float slope = 1.f / (right - left);
+                const float leftFrac = left - leftFloor;
+                const float first = 0.5f * slope * (1.f - leftFrac) * (1.f - leftFrac);
+                const float rightFrac = right - rightCeil + 1.f;
+                const float last = 0.5f * slope * rightFrac * rightFrac;
+                row[leftIndex] += d * first;
+                if (rightIndex == leftIndex + 2)
+                    row[leftIndex + 1] += d * (1.f - first - last);
+                else
+                {
+                    const float second = slope * (1.5f - leftFrac);
+                    row[leftIndex + 1] += d * (second - first);
+                    for (int i = leftIndex + 2; i < rightIndex - 1; ++i)
+                        row[i] += d * slope;
+                    const float beforeLast = second + (rightIndex - leftIndex - 3) * slope;
+                    row[rightIndex - 1] += d * (1.f - beforeLast - last);
+                }
+                row[rightIndex] += d * last;
+            }
+            x = xNext;
+        }
+    }
+
+    float sum = 0.f;
+    for (size_t i = 0; i < texels; ++i)
+    {
+        sum += accumulation[i];
+        dst[i] = uint8_t(std::min(fabsf(sum), 1.f) * 255.f + 0.5f);
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef __TRUETYPE_H__
+#define __TRUETYPE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Just enough of a TrueType font to rasterize its glyphs: the cmap, horizontal metrics and glyf outlines
+// The file is memory mapped and nothing is decoded up front, so opening a large font is cheap and glyphs can be
+// read from any number of threads at once.
+// NOTE only quadratic (glyf) outlines; CFF based OpenType fonts and collections aren't supported, and hinting
+// instructions are ignored
+class TrueTypeFont
+{
+public:
+    // Outline segment in bitmap space, x right and y down
+    struct Line
+    {
+        float x0, y0, x1, y1;
+    };
+
+    // Bounding box in font units, y up
+    struct Box
+    {
+        int xMin, yMin, xMax, yMax;
+    };
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    uint32_t m_glyf, m_glyfSize;
+    uint32_t m_loca;
+    uint32_t m_hmtx;
+    uint32_t m_cmap; // the chosen subtable
+    int m_cmapFormat;
+    int m_glyphCount;
+    int m_hMetricCount;
+    int m_unitsPerEm;
+    bool m_longLoca;
+    int m_ascent, m_descent, m_lineGap;
+
+public:
+    TrueTypeFont(): m_data(nullptr), m_size(0), m_glyf(0), m_glyfSize(0), m_loca(0), m_hmtx(0), m_cmap(0), m_cmapFormat(0),
+        m_glyphCount(0), m_hMetricCount(0), m_unitsPerEm(0), m_longLoca(false), m_ascent(0), m_descent(0), m_lineGap(0) {}
+    ~TrueTypeFont() {close();}
+
+    TrueTypeFont(const TrueTypeFont&) = delete;
+    TrueTypeFont& operator=(const TrueTypeFont&) = delete;
+
+    // Maps the file and finds its tables
+    bool open(const char* path);
+    void close();
+
+    int glyphCount() const {return m_glyphCount;}
+    int unitsPerEm() const {return m_unitsPerEm;}
+
+    // Vertical metrics in font units; the descent is negative
+    int ascent() const {return m_ascent;}
+    int descent() const {return m_descent;}
+    int lineGap() const {return m_lineGap;}
+
+    // Glyph for a Unicode code point, or 0 (the missing glyph) if the font doesn't have one
+    int glyphIndex(uint32_t codepoint) const;
+
+    // Every code point the font maps to a glyph, in ascending order
+    void codepoints(std::vector<uint32_t>& dst) const;
+
+    void horizontalMetrics(int glyph, int& advance, int& leftBearing) const;
+
+    // Returns false for a glyph with no outline, like a space
+    bool glyphBox(int glyph, Box& box) const;
+
+    // Appends the glyph's outline flattened to lines, mapped to bitmap space by x * scale + dx and dy - y * scale
+    bool outline(int glyph, float scale, float dx, float dy, std::vector<Line>& lines) const;
+
+    // Coverage from 0 to 255 of a closed outline, nonzero winding, exact area per pixel
+    // NOTE accumulation must hold width * height + 2 floats; lines are clamped to the bitmap
+    static void rasterize(const std::vector<Line>& lines, int width, int height, float* accumulation, uint8_t* dst);
+
+private:
+    bool glyphData(int glyph, uint32_t& offset, uint32_t& size) const;
+    bool appendOutline(int glyph, const float* transform, int depth, std::vector<Line>& lines) const;
+    bool appendSimple(uint32_t offset, uint32_t size, int contours, const float* transform, std::vector<Line>& lines) const;
+    bool appendComposite(uint32_t offset, uint32_t size, const float* transform, int depth, std::vector<Line>& lines) const;
+};
+
+#endif //__TRUETYPE_H__
@@ -24,7 +24,14 @@ public:
 
     void init(TwBar* tweakBar, const char* name, const char* desc, WrapperCb callback)
     {
-        TwAddVarCB(tweakBar, name, type(), SetCallback, GetCallback, this, desc);
+        init(tweakBar, name, type(), desc, callback);
+    }
+
+    // For types without a built in TwType, e.g. enums defined with TwDefineEnum
+    // NOTE T must have the same size as the TwType's values; enums should have an int32_t base
+    void init(TwBar* tweakBar, const char* name, TwType twType, const char* desc, WrapperCb callback)
+    {
+        TwAddVarCB(tweakBar, name, twType, SetCallback, GetCallback, this, desc);
         m_callback = callback;
     }
 
@@ -49,7 +56,7 @@ private:
     }
 };
 
-// TODO handle enum, color, quat, dir - maybe define struct wrappers
+// TODO handle color, quat, dir - maybe define struct wrappers
 template <> constexpr TwType TwWrapper<bool>::type() {return TW_TYPE_BOOLCPP;}
 template <> constexpr TwType TwWrapper<char>::type() {return TW_TYPE_CHAR;}
 template <> constexpr TwType TwWrapper<int8_t>::type() {return TW_TYPE_INT8;}
@@ -1,31 +1,216 @@
 #include "GlfwInstance.h"
 #include "SDFScene.h"
+#include "TextScene.h"
+#include "SoftwareScene.h"
+#include "ThreadPool.h"
+#include "Trace.h"
 
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+struct Options
+{
+    bool software = false;
+    bool continuous = false;
+    bool vsync = true;
+    bool fixedStep = false;
+    bool backgroundScenes = false;
+    int frames = 0; // 0 for no limit
+    double seconds = 0.0;
+    double tickRate = GlfwInstance::DEFAULT_TICK_RATE;
+    int texPow = 5;
+    const char* output = nullptr;
+    const char* tracePath = nullptr;
+    const char* maskPath = nullptr;
+    bool maskInvert = false;
+    const char* fontPath = nullptr;
+};
+
+static void usage(const char* program)
+{
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --frames N         stop after N frames and print a summary\n"
+        "  --seconds T        stop after T seconds and print a summary\n"
+        "  --no-vsync         don't wait for vsync on swap\n"
+        "  --fixed-step       advance exactly one tick per frame\n"
+        "  --tick-rate HZ     scene updates per second (default %g)\n"
+        "  --continuous       redraw every frame instead of on demand\n"
+        "  --background       keep baking scenes that aren't shown\n"
+        "  --mask FILE        add a scene baked from a PGM or PNG mask, bright inside\n"
+        "  --mask-invert      treat dark pixels of the mask as inside\n"
+        "  --font FILE        add a scene of text drawn from a TrueType font's glyph atlas\n"
+        "  --trace FILE       trace hotkey path; also writes the trace on exit\n"
+        "  --software         render on the CPU without a window\n"
+        "  --tex-pow P        texture size for --software\n"
+        "  --output FILE      write the last --software frame as a PPM\n",
+        program, GlfwInstance::DEFAULT_TICK_RATE);
+}
+
+// Renders frames on the CPU without opening a window, always stepping one tick per frame
+static int runSoftware(const Options& options)
+{
+    SoftwareScene scene(SDFScene::WIDTH, SDFScene::HEIGHT);
+    scene.setTexPow(options.texPow);
+
+    // Without a limit there'd be no way to stop, so render a single frame
+    const int frames = options.frames > 0 || options.seconds > 0.0 ? options.frames : 1;
+
+    RunSummary summary;
+    if (frames > 0)
+        summary.reserve(frames);
+
+    const double tick = 1.0 / options.tickRate;
+    const auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    Trace::setThreadName("Main");
+    while ((frames == 0 || summary.frames() < frames) && (options.seconds <= 0.0 || elapsed < options.seconds))
+    {
+        const auto frameStart = std::chrono::steady_clock::now();
+        {
+            TRACE_SCOPE("Frame");
+            scene.prepare(0.0);
+            scene.render(0.0);
+            scene.update(tick);
+        }
+        const auto frameEnd = std::chrono::steady_clock::now();
+        summary.addFrame(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+        elapsed = std::chrono::duration<double>(frameEnd - start).count();
+    }
+
+    summary.print(elapsed, scene.bakes());
+
+    if (options.output && !scene.writePPM(options.output))
+    {
+        fprintf(stderr, "Failed to write %s\n", options.output);
+        return -1;
+    }
+
+    if (options.tracePath)
+        Trace::dump(options.tracePath);
+
+    return 0;
+}
 
 int main(int argc, char* argv[])
 {
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--software") == 0)
+            options.software = true;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            options.frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            options.seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--no-vsync") == 0)
+            options.vsync = false;
+        else if (strcmp(argv[i], "--fixed-step") == 0)
+            options.fixedStep = true;
+        else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+            options.tickRate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--tex-pow") == 0 && i + 1 < argc)
+            options.texPow = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            options.output = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            options.tracePath = argv[++i];
+        else if (strcmp(argv[i], "--continuous") == 0)
+            options.continuous = true;
+        else if (strcmp(argv[i], "--background") == 0)
+            options.backgroundScenes = true;
+        else if (strcmp(argv[i], "--mask") == 0 && i + 1 < argc)
+            options.maskPath = argv[++i];
+        else if (strcmp(argv[i], "--mask-invert") == 0)
+            options.maskInvert = true;
+        else if (strcmp(argv[i], "--font") == 0 && i + 1 < argc)
+            options.fontPath = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (options.frames < 0 || options.seconds < 0.0 || options.tickRate <= 0.0)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+
+    if (options.software)
+    {
+        if (options.texPow < 1 || options.texPow > 14)
+        {
+            fprintf(stderr, "Tex pow must be between 1 and 14\n");
+            return -1;
+        }
+        return runSoftware(options);
+    }
+
     GlfwInstance instance;
-    
+    instance.setVsync(options.vsync);
+
     if (!instance.init(SDFScene::NAME, SDFScene::WIDTH, SDFScene::HEIGHT))
     {
         fprintf(stderr, "Failed to init instance\n");
         return -1;
     }
-    
-    SDFScene scene;
-    
-    if (!scene.init())
+
+    // One pool bakes for every scene; scenes only ever bake one at a time, on this thread
+    ThreadPool pool;
+
+    // All scenes are loaded up front; the scene key switches between them
+    // NOTE only the scenes that get registered are constructed, so an unused one costs nothing
+    // A mask or font given on the command line is what the user wants to see first
+    std::vector<std::unique_ptr<Scene>> scenes;
+    if (options.fontPath)
+        scenes.emplace_back(new TextScene("Text", options.fontPath, pool));
+    if (options.maskPath)
     {
-        fprintf(stderr, "Failed to init scene\n");
-        return -1;
+        std::unique_ptr<SDFScene> imageScene(new SDFScene("Image", pool));
+        imageScene->setMaskImage(options.maskPath, options.maskInvert);
+        scenes.push_back(std::move(imageScene));
+    }
+    scenes.emplace_back(new SDFScene("Circle", pool));
+    std::unique_ptr<SDFScene> squareScene(new SDFScene("Square", pool));
+    squareScene->setDrawCircle(false);
+    scenes.push_back(std::move(squareScene));
+
+    for (const auto& scene : scenes)
+    {
+        if (!scene->init())
+        {
+            fprintf(stderr, "Failed to init scene %s\n", scene->name());
+            return -1;
+        }
+        instance.addScene(scene.get());
     }
-    
-    instance.setScene(&scene);
-    
+    instance.setBackgroundScenes(options.backgroundScenes);
+    if (options.tracePath)
+        instance.setTracePath(options.tracePath);
+
+    // A limited run measures throughput, so it must never sleep waiting for input
+    const bool limited = options.frames > 0 || options.seconds > 0.0;
+    instance.setOnDemand(!options.continuous && !limited);
+    instance.setTickRate(options.tickRate);
+    instance.setFixedStep(options.fixedStep);
+    instance.setFrameLimit(options.frames);
+    instance.setTimeLimit(options.seconds);
+
     instance.run();
 
-    scene.close();
+    // The hotkey dumps whenever asked; asking on the command line also dumps on the way out
+    if (options.tracePath)
+        Trace::dump(options.tracePath);
+
+    for (const auto& scene : scenes)
+        scene->close();
 
     instance.close();
 